@@ -0,0 +1,172 @@
+/* LDPC decoder benchmark
+ *
+ * Decodes noisy frames at a range of Eb/N0 with each decoding mode and with
+ * the batch decoder, and reports the packet error rate and throughput.
+ * Then compares the fixed-point decoder at several quantiser scales with
+ * the double precision layered NMS decoder it approximates. First prints
+ * the size of the code description and of the tables expanded from it.
+ *
+ * The all-zeros codeword is transmitted as BPSK (0 -> +1) over AWGN; all the
+ * decoders are symmetric so this gives the same error rates as random data.
+ */
+
+#include "ldpc_decoder.h"
+#include "ldpc_fixed.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+
+static uint64_t rng_state = 0x853C49E6748FEA9BULL;
+
+/* xorshift64* uniform on (0, 1]. */
+static double randu(void)
+{
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return ((rng_state * 0x2545F4914F6CDD1DULL) >> 11) * (1.0 / 9007199254740992.0)
+           + (1.0 / 9007199254740992.0);
+}
+
+/* Standard normal by Box-Muller. */
+static double randn(void)
+{
+    return sqrt(-2.0 * log(randu())) * cos(2.0 * M_PI * randu());
+}
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char* argv[])
+{
+    const char* mode_names[] = {"flooding SPA", "layered NMS", "layered OMS",
+                                "fixed NMS"};
+    const double scales[] = {1.0, 2.0, 4.0, 8.0};
+    int nframes = 1000;
+    int mode, f, a, i, s, errors;
+    double ebn0_db, sigma, t0, t_total;
+    double (*frames)[N];
+    float (*frames_f)[N];
+    uint8_t out[K/8];
+    uint8_t *batch_out;
+    bool ok, *batch_ok;
+    ldpc_stats stats;
+    long iters;
+
+    if(argc > 1)
+        nframes = atoi(argv[1]);
+
+    frames = malloc(nframes * sizeof(*frames));
+    frames_f = malloc(nframes * sizeof(*frames_f));
+    batch_out = malloc(nframes * K/8);
+    batch_ok = malloc(nframes * sizeof(bool));
+    if(frames == NULL || frames_f == NULL || batch_out == NULL ||
+       batch_ok == NULL)
+        return 1;
+
+    t0 = now();
+    ldpc_init();
+    t_total = now() - t0;
+
+    printf("Code description\t%zu bytes\n", sizeof(parity_code));
+    printf("Edge list\t\t%zu bytes\n",
+           sizeof(parity_row_start) + sizeof(parity_edge_col) +
+           sizeof(parity_col_start) + sizeof(parity_col_edges));
+    printf("Packed rows\t\t%zu bytes\n", sizeof(parity_Hp));
+    printf("ldpc_init\t\t%.1f us\n\n", t_total * 1e6);
+
+    printf("Eb/N0\tmode\t\tPER\t\tframes/s\titers\n");
+    for(ebn0_db=1.0; ebn0_db<=4.0; ebn0_db+=0.5) {
+        /* Rate 1/2 code, so Es/N0 = Eb/N0 / 2 and sigma^2 = 1/(2 Es/N0). */
+        sigma = sqrt(1.0 / pow(10.0, ebn0_db / 10.0));
+
+        /* Every mode sees the same frames. */
+        for(f=0; f<nframes; f++)
+            for(a=0; a<N; a++)
+                frames[f][a] = 2.0 * (1.0 + sigma * randn()) / (sigma * sigma);
+
+        for(mode=LDPC_MODE_FLOODING_SPA; mode<=LDPC_MODE_LAYERED_NMS_FIXED;
+            mode++) {
+            ldpc_set_mode((ldpc_mode)mode);
+            errors = 0;
+            iters = 0;
+            t0 = now();
+            for(f=0; f<nframes; f++) {
+                ok = ldpc_decode_stats(frames[f], out, &stats);
+                iters += stats.iterations;
+                for(i=0; i<K/8; i++)
+                    ok = ok && out[i] == 0;
+                if(!ok)
+                    errors++;
+            }
+            t_total = now() - t0;
+            printf("%.1f\t%s\t%.3e\t%.0f\t\t%.2f\n", ebn0_db,
+                   mode_names[mode], (double)errors / nframes,
+                   nframes / t_total, (double)iters / nframes);
+        }
+
+        /* The batch decoder takes single precision LLRs. */
+        for(f=0; f<nframes; f++)
+            for(a=0; a<N; a++)
+                frames_f[f][a] = frames[f][a];
+        errors = 0;
+        t0 = now();
+        ldpc_decode_batch(&frames_f[0][0], nframes, batch_out, batch_ok);
+        t_total = now() - t0;
+        for(f=0; f<nframes; f++) {
+            ok = batch_ok[f];
+            for(i=0; i<K/8; i++)
+                ok = ok && batch_out[f*(K/8) + i] == 0;
+            if(!ok)
+                errors++;
+        }
+        printf("%.1f\tbatch NMS\t%.3e\t%.0f\n", ebn0_db,
+               (double)errors / nframes, nframes / t_total);
+    }
+
+    /* PER of the fixed-point decoder at each quantiser scale, against the
+     * double precision decoder on the same frames.
+     */
+    printf("\nFixed-point loss, %d bit messages\n", LDPC_FIXED_BITS);
+    printf("Eb/N0\tdouble NMS");
+    for(s=0; s<(int)(sizeof(scales)/sizeof(scales[0])); s++)
+        printf("\tscale %-4g", scales[s]);
+    printf("\n");
+    for(ebn0_db=2.0; ebn0_db<=3.5; ebn0_db+=0.5) {
+        sigma = sqrt(1.0 / pow(10.0, ebn0_db / 10.0));
+        for(f=0; f<nframes; f++)
+            for(a=0; a<N; a++)
+                frames[f][a] = 2.0 * (1.0 + sigma * randn()) / (sigma * sigma);
+
+        printf("%.1f", ebn0_db);
+        for(s=-1; s<(int)(sizeof(scales)/sizeof(scales[0])); s++) {
+            if(s < 0) {
+                ldpc_set_mode(LDPC_MODE_LAYERED_NMS);
+            } else {
+                ldpc_set_mode(LDPC_MODE_LAYERED_NMS_FIXED);
+                ldpc_set_quantizer(scales[s]);
+            }
+            errors = 0;
+            for(f=0; f<nframes; f++) {
+                ok = ldpc_decode(frames[f], out);
+                for(i=0; i<K/8; i++)
+                    ok = ok && out[i] == 0;
+                if(!ok)
+                    errors++;
+            }
+            printf("\t%.3e", (double)errors / nframes);
+        }
+        printf("\n");
+    }
+
+    free(frames);
+    free(frames_f);
+    free(batch_out);
+    free(batch_ok);
+    return 0;
+}
@@ -1,101 +1,512 @@
 #include <math.h>
-#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include "ldpc_decoder.h"
+#include "ldpc_fixed.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_X86_SIMD 1
+#include <immintrin.h>
+#endif
 
 /* Maximum number of iterations to attempt to decode a message for. */
 #define MAX_ITERS (100)
 
-/* Hard decode the systematic message bits in `llrs`, packing them MSb first
- * into `out`.
+/* Scale factor applied to check node messages in normalised min-sum. */
+#define NMS_ALPHA (0.75)
+
+/* Offset subtracted from check node messages in offset min-sum. */
+#define OMS_BETA (0.5)
+
+/* Largest tanh product passed to atanh, limiting SPA messages to about 28. */
+#define SPA_MAX_PROD (1.0 - 1e-12)
+
+/* Algorithm and fixed-point quantiser scale used by ldpc_decode. */
+static ldpc_mode decode_mode = LDPC_MODE_LAYERED_NMS_FIXED;
+static double decode_scale = LDPC_FIXED_DEFAULT_SCALE;
+
+/* Parity structure used by ldpc_decode, copied in by ldpc_init. */
+static parity_graph default_graph;
+
+/* Message storage for one decode. u and v hold the check to variable and
+ * variable to check messages per edge, t the per-edge tanh values for SPA
+ * or the variable messages q for layered decoding, and r the marginals.
+ * The fixed-point decoder uses its own workspace and the quantised LLRs.
  */
-static void pack_message(double llrs[N], uint8_t out[K/8])
+typedef struct {
+    double u[E];
+    double v[E];
+    double t[E];
+    double r[N];
+    ldpc_fixed_msg llrs_q[N];
+    ldpc_fixed_workspace fixed;
+} ldpc_workspace;
+
+struct ldpc_ctx {
+    ldpc_mode mode;
+    double scale;
+    parity_graph graph;
+    ldpc_workspace ws;
+};
+
+#ifdef HAVE_X86_SIMD
+/* Set by ldpc_init if the CPU can run the AVX2 batch decoder. */
+static bool have_avx2 = false;
+#endif
+
+/* Hard decide the marginals `r` after `iter` iterations, pack the
+ * systematic message bits MSb first into `out`, and check the syndrome,
+ * recording its weight in `stats`. Returns true if r is a codeword.
+ */
+static bool check_codeword(const parity_graph* g, double r[N],
+                           uint8_t out[K/8], int iter, ldpc_stats* stats)
 {
-    unsigned int i;
-    
-    for(i=0; i<K/8; i++)
-        out[i] = 0x00;
+    uint64_t hard[N/64];
+    int i, weight;
 
-    for(i=0; i<N/2; i++)
-        if(llrs[i] <= 0.0)
-            out[i/8] |= 1 << (7 - (i % 8));
+    parity_matrix_hard_decision(r, hard);
+    weight = parity_graph_syndrome_weight(g, hard);
+
+    if(iter == 0)
+        stats->initial_syndrome_weight = weight;
+    stats->iterations = iter;
+    stats->syndrome_weight = weight;
+
+    for(i=0; i<K/8; i++)
+        out[i] = hard[i/8] >> (56 - 8*(i % 8));
+    return weight == 0;
 }
 
 void ldpc_init()
 {
     parity_matrix_init();
+    parity_matrix_graph(&default_graph);
+
+#ifdef HAVE_X86_SIMD
+    __builtin_cpu_init();
+    have_avx2 = __builtin_cpu_supports("avx2");
+#endif
 }
 
-#include <string.h>
+void ldpc_set_mode(ldpc_mode mode)
+{
+    decode_mode = mode;
+}
 
-extern bool ldpc_decode(double llrs[N], uint8_t out[K/8])
+void ldpc_set_quantizer(double scale)
 {
-    double u[K][N];
-    double v[N][K];
-    double r[N];
-    int iter, i, j, a, b, idx1, idx2;
+    decode_scale = scale;
+}
 
-    /* Copy llrs to r and to v_(a->i). */
-    for(a=0; a<N; a++) {
-        r[a] = llrs[a];
-        /*for(i=0; i<K; i++)*/
-            /*v[a][i] = llrs[a];*/
-        /*for(idx1=0; idx1<parity_col_degs[a]; idx1++) {*/
-            /*i = parity_col_cons[a][idx1];*/
-            /*v[a][i] = llrs[a];*/
-        /*}*/
-    }
+/* Flooding schedule sum-product decoder.
+ *
+ * Messages are stored per edge: u[e] is the check to variable message and
+ * v[e] the variable to check message along edge e.
+ */
+static bool decode_flooding_spa(const parity_graph* g, ldpc_workspace* ws,
+                                const double llrs[N], uint8_t out[K/8],
+                                ldpc_stats* stats)
+{
+    double* u = ws->u;
+    double* v = ws->v;
+    double* t = ws->t;
+    double* r = ws->r;
+    int iter, i, a, e, e0, e1, idx;
+    double prod;
 
+    /* Start with r and each v_(a->i) equal to the channel LLRs. Starting
+     * the v at zero instead, as this decoder once did, makes every first
+     * check message zero, wasting the first iteration and reporting one
+     * more iteration for each decode than is needed.
+     */
     for(a=0; a<N; a++)
-        for(i=0; i<K; i++)
-            v[a][i] = 0.0f;
+        r[a] = llrs[a];
+    for(e=0; e<E; e++)
+        v[e] = llrs[g->edge_col[e]];
 
     for(iter=0; iter<MAX_ITERS; iter++) {
         /* First check if we succeeded in decoding,
          * and if so then pack the message and return it.
          */
-        if(parity_matrix_check(r)) {
-            pack_message(r, out);
+        if(check_codeword(g, r, out, iter, stats))
             return true;
-        }
 
         /* Next compute the check node to variable node messages,
-         * u_(i->a) = 2 atanh( prod_[b!=a]( tanh( v_(b->i)/2 ) ) )
+         * u_(i->a) = 2 atanh( prod_[b!=a]( tanh( v_(b->i)/2 ) ) ).
+         * Each tanh is computed once per edge, and the products excluding
+         * each edge are formed from prefix and suffix products.
          */
         for(i=0; i<K; i++) {
-            for(idx1=0; idx1<parity_row_degs[i]; idx1++) {
-                a = parity_row_cons[i][idx1];
-                u[i][a] = 1.0f;
-                for(idx2=0; idx2<parity_row_degs[i]; idx2++) {
-                    b = parity_row_cons[i][idx2];
-                    if(b != a)
-                        u[i][a] *= tanh(v[b][i] / 2.0f);
-                }
-                u[i][a] = 2.0f * atanh(u[i][a]);
+            e0 = g->row_start[i];
+            e1 = g->row_start[i+1];
+
+            prod = 1.0;
+            for(e=e0; e<e1; e++) {
+                t[e] = tanh(v[e] / 2.0);
+                u[e] = prod;
+                prod *= t[e];
+            }
+
+            prod = 1.0;
+            for(e=e1-1; e>=e0; e--) {
+                u[e] *= prod;
+                prod *= t[e];
+                /* Keep atanh finite when every other message is certain. */
+                u[e] = fmax(fmin(u[e], SPA_MAX_PROD), -SPA_MAX_PROD);
+                u[e] = 2.0 * atanh(u[e]);
             }
         }
 
-        /* Finally compute the variable node to check node messages,
-         * v_(a->i) = LLRs_a + sum_[j!=i](u_(j->a)),
-         * and the current marginals,
-         * r_a = LLRs_a + sum_[i] u_(i->a)
+        /* Finally compute the current marginals,
+         * r_a = LLRs_a + sum_[i] u_(i->a),
+         * and the variable node to check node messages,
+         * v_(a->i) = LLRs_a + sum_[j!=i](u_(j->a)) = r_a - u_(i->a).
          */
         for(a=0; a<N; a++) {
-            for(idx1=0; idx1<parity_col_degs[a]; idx1++) {
-                i = parity_col_cons[a][idx1];
-                v[a][i] = llrs[a];
-                for(idx2=0; idx2<parity_col_degs[a]; idx2++) {
-                    j = parity_col_cons[a][idx2];
-                    if(j != i)
-                        v[a][i] += u[j][a];
+            r[a] = llrs[a];
+            for(idx=g->col_start[a]; idx<g->col_start[a+1]; idx++)
+                r[a] += u[g->col_edges[idx]];
+            for(idx=g->col_start[a]; idx<g->col_start[a+1]; idx++) {
+                e = g->col_edges[idx];
+                v[e] = r[a] - u[e];
+            }
+        }
+    }
+
+    /* Check the final iteration, failing if it hasn't decoded. */
+    return check_codeword(g, r, out, MAX_ITERS, stats);
+}
+
+/* Layered schedule min-sum decoder.
+ *
+ * The marginals r_a start as the channel LLRs and each row i of H is
+ * processed in turn: the row's old check message is removed from each
+ * connected marginal to give the variable message q_a = r_a - u_(i->a),
+ * the new check messages are computed from the q_a by min-sum, and then
+ * added straight back in, r_a = q_a + u_(i->a).
+ *
+ * When `offset` is set the min-sum magnitude is reduced by OMS_BETA,
+ * otherwise it is scaled by NMS_ALPHA.
+ */
+static bool decode_layered(const parity_graph* g, ldpc_workspace* ws,
+                           const double llrs[N], uint8_t out[K/8], bool offset,
+                           ldpc_stats* stats)
+{
+    double* u = ws->u;
+    double* q = ws->t;
+    double* r = ws->r;
+    int iter, i, a, e, min_e;
+    double min1, min2, mag, sgn;
+
+    for(a=0; a<N; a++)
+        r[a] = llrs[a];
+
+    for(e=0; e<E; e++)
+        u[e] = 0.0;
+
+    for(iter=0; iter<MAX_ITERS; iter++) {
+        if(check_codeword(g, r, out, iter, stats))
+            return true;
+
+        for(i=0; i<K; i++) {
+            /* Find the two smallest magnitudes and the overall sign of the
+             * variable messages into this check node.
+             */
+            min1 = min2 = INFINITY;
+            min_e = 0;
+            sgn = 1.0;
+            for(e=g->row_start[i]; e<g->row_start[i+1]; e++) {
+                q[e] = r[g->edge_col[e]] - u[e];
+                mag = fabs(q[e]);
+                if(q[e] < 0.0)
+                    sgn = -sgn;
+                if(mag < min1) {
+                    min2 = min1;
+                    min1 = mag;
+                    min_e = e;
+                } else if(mag < min2) {
+                    min2 = mag;
                 }
             }
 
-            r[a] = llrs[a];
-            for(i=0; i<K; i++)
-                r[a] += u[i][a];
+            /* Apply the correction once per row rather than per edge. */
+            if(offset) {
+                min1 = fmax(min1 - OMS_BETA, 0.0);
+                min2 = fmax(min2 - OMS_BETA, 0.0);
+            } else {
+                min1 *= NMS_ALPHA;
+                min2 *= NMS_ALPHA;
+            }
+
+            /* Each edge gets the smallest magnitude excluding itself and the
+             * product of the other signs, then updates its marginal.
+             */
+            for(e=g->row_start[i]; e<g->row_start[i+1]; e++) {
+                mag = (e == min_e) ? min2 : min1;
+                u[e] = (q[e] < 0.0) ? -sgn * mag : sgn * mag;
+                r[g->edge_col[e]] = q[e] + u[e];
+            }
+        }
+    }
+
+    /* Check the final iteration, failing if it hasn't decoded. */
+    return check_codeword(g, r, out, MAX_ITERS, stats);
+}
+
+extern bool ldpc_decode(double llrs[N], uint8_t out[K/8])
+{
+    return ldpc_decode_stats(llrs, out, NULL);
+}
+
+/* Decode with `mode`, using the parity structure `g` and messages in `ws`,
+ * quantising by `scale` for the fixed-point mode.
+ */
+static bool decode(ldpc_mode mode, double scale, const parity_graph* g,
+                   ldpc_workspace* ws, const double llrs[N], uint8_t out[K/8],
+                   ldpc_stats* stats)
+{
+    ldpc_stats unused;
+
+    if(stats == NULL)
+        stats = &unused;
+
+    switch(mode) {
+        case LDPC_MODE_LAYERED_NMS:
+            return decode_layered(g, ws, llrs, out, false, stats);
+        case LDPC_MODE_LAYERED_OMS:
+            return decode_layered(g, ws, llrs, out, true, stats);
+        case LDPC_MODE_LAYERED_NMS_FIXED:
+            ldpc_fixed_quantize(llrs, ws->llrs_q, N, scale);
+            return ldpc_fixed_decode(g, &ws->fixed, ws->llrs_q, out, stats);
+        case LDPC_MODE_FLOODING_SPA:
+        default:
+            return decode_flooding_spa(g, ws, llrs, out, stats);
+    }
+}
+
+bool ldpc_decode_stats(double llrs[N], uint8_t out[K/8], ldpc_stats* stats)
+{
+    ldpc_workspace ws;
+    return decode(decode_mode, decode_scale, &default_graph, &ws, llrs, out,
+                  stats);
+}
+
+ldpc_ctx* ldpc_ctx_new(ldpc_mode mode)
+{
+    ldpc_ctx* ctx = malloc(sizeof(ldpc_ctx));
+    if(ctx == NULL)
+        return NULL;
+    ctx->mode = mode;
+    ctx->scale = LDPC_FIXED_DEFAULT_SCALE;
+    parity_matrix_graph(&ctx->graph);
+    return ctx;
+}
+
+void ldpc_ctx_free(ldpc_ctx* ctx)
+{
+    free(ctx);
+}
+
+void ldpc_ctx_set_mode(ldpc_ctx* ctx, ldpc_mode mode)
+{
+    ctx->mode = mode;
+}
+
+void ldpc_ctx_set_quantizer(ldpc_ctx* ctx, double scale)
+{
+    ctx->scale = scale;
+}
+
+bool ldpc_ctx_decode(ldpc_ctx* ctx, const double llrs[N], uint8_t out[K/8],
+                     ldpc_stats* stats)
+{
+    return decode(ctx->mode, ctx->scale, &ctx->graph, &ctx->ws, llrs, out,
+                  stats);
+}
+
+#ifdef HAVE_X86_SIMD
+/* Pack the message bits of `lane` from the per-variable lane masks in
+ * `hard` into K/8 bytes at `out`.
+ */
+static void pack_lane(const uint8_t hard[N], unsigned int lane, uint8_t* out)
+{
+    int a;
+
+    memset(out, 0, K/8);
+    for(a=0; a<N/2; a++)
+        out[a/8] |= ((hard[a] >> lane) & 1) << (7 - a%8);
+}
+
+/* Decode LDPC_BATCH_LANES frames at once with layered normalised min-sum,
+ * one frame per AVX2 lane. `llrs` points to the first frame, and frames
+ * are N floats apart. Lanes stop updating as soon as their frame decodes,
+ * and the batch finishes when every lane has stopped.
+ */
+__attribute__((target("avx2")))
+static void decode_batch_avx2(const float* llrs, uint8_t* out, bool* ok)
+{
+    __m256 r[N];
+    __m256 u[E];
+    uint8_t hard[N];
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 signbit = _mm256_set1_ps(-0.0f);
+    const __m256 alpha = _mm256_set1_ps((float)NMS_ALPHA);
+    __m256 active, q, mag, min1, min2, min1_a, min2_a, sgn, r_new;
+    unsigned int done = 0, failed, lane;
+    int iter, i, a, e;
+    float lanes[LDPC_BATCH_LANES];
+
+    /* Transpose the frames so each variable holds one LLR per lane. */
+    for(a=0; a<N; a++) {
+        for(lane=0; lane<LDPC_BATCH_LANES; lane++)
+            lanes[lane] = llrs[lane*N + a];
+        r[a] = _mm256_loadu_ps(lanes);
+    }
+
+    for(e=0; e<E; e++)
+        u[e] = zero;
+
+    for(iter=0; iter<=MAX_ITERS; iter++) {
+        /* Hard decide every lane at once, one bit per lane for each
+         * variable, then XOR them along each row to find which lanes fail
+         * each parity check.
+         */
+        for(a=0; a<N; a++)
+            hard[a] = _mm256_movemask_ps(_mm256_cmp_ps(r[a], zero, _CMP_LE_OQ));
+        failed = 0;
+        for(i=0; i<K; i++) {
+            uint8_t parity = 0;
+            for(e=parity_row_start[i]; e<parity_row_start[i+1]; e++)
+                parity ^= hard[parity_edge_col[e]];
+            failed |= parity;
+        }
+
+        /* Write out any lanes that have just decoded. */
+        for(lane=0; lane<LDPC_BATCH_LANES; lane++) {
+            if((done >> lane) & 1 || (failed >> lane) & 1)
+                continue;
+            pack_lane(hard, lane, &out[lane*(K/8)]);
+            ok[lane] = true;
+            done |= 1 << lane;
+        }
+
+        if(done == (1 << LDPC_BATCH_LANES) - 1 || iter == MAX_ITERS)
+            break;
+
+        /* Lanes still decoding have all 32 bits set in `active`. */
+        active = _mm256_castsi256_ps(_mm256_cmpeq_epi32(
+            _mm256_and_si256(_mm256_set1_epi32(done),
+                             _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128)),
+            _mm256_setzero_si256()));
+
+        for(i=0; i<K; i++) {
+            /* First pass finds the two smallest magnitudes and the sign
+             * product of q = r - u in every lane.
+             */
+            min1 = min2 = _mm256_set1_ps(INFINITY);
+            sgn = zero;
+            for(e=parity_row_start[i]; e<parity_row_start[i+1]; e++) {
+                q = _mm256_sub_ps(r[parity_edge_col[e]], u[e]);
+                mag = _mm256_andnot_ps(signbit, q);
+                sgn = _mm256_xor_ps(sgn, _mm256_and_ps(signbit, q));
+                min2 = _mm256_min_ps(min2, _mm256_max_ps(min1, mag));
+                min1 = _mm256_min_ps(min1, mag);
+            }
+            min1_a = _mm256_mul_ps(min1, alpha);
+            min2_a = _mm256_mul_ps(min2, alpha);
+
+            /* Second pass recomputes q, which is unchanged since no column
+             * appears twice in a row, and writes back the new messages and
+             * marginals for the active lanes only.
+             */
+            for(e=parity_row_start[i]; e<parity_row_start[i+1]; e++) {
+                a = parity_edge_col[e];
+                q = _mm256_sub_ps(r[a], u[e]);
+                mag = _mm256_andnot_ps(signbit, q);
+                mag = _mm256_blendv_ps(min1_a, min2_a,
+                                       _mm256_cmp_ps(mag, min1, _CMP_EQ_OQ));
+                mag = _mm256_xor_ps(mag, _mm256_xor_ps(sgn,
+                                    _mm256_and_ps(signbit, q)));
+                u[e] = _mm256_blendv_ps(u[e], mag, active);
+                r_new = _mm256_add_ps(q, mag);
+                r[a] = _mm256_blendv_ps(r[a], r_new, active);
+            }
+        }
+    }
+
+    /* Lanes that never decoded get their final hard decision, as the
+     * scalar decoders give.
+     */
+    for(lane=0; lane<LDPC_BATCH_LANES; lane++) {
+        if((done >> lane) & 1)
+            continue;
+        pack_lane(hard, lane, &out[lane*(K/8)]);
+    }
+}
+#endif
+
+/* Decode one frame of float LLRs with the layered normalised min-sum
+ * decoder, for CPUs without AVX2.
+ */
+static bool decode_batch_scalar(const float* llrs, uint8_t* out)
+{
+    double r[N];
+    int a;
+    ldpc_workspace ws;
+    ldpc_stats stats;
+
+    for(a=0; a<N; a++)
+        r[a] = llrs[a];
+    return decode_layered(&default_graph, &ws, r, out, false, &stats);
+}
+
+size_t ldpc_decode_batch(const float* llrs, size_t nframes,
+                         uint8_t* out, bool* ok)
+{
+    size_t f, n_ok = 0;
+
+    for(f=0; f<nframes; f++)
+        ok[f] = false;
+
+#ifdef HAVE_X86_SIMD
+    if(have_avx2) {
+        size_t lane;
+        int a;
+        float pad[LDPC_BATCH_LANES][N];
+        uint8_t pad_out[LDPC_BATCH_LANES][K/8];
+        bool pad_ok[LDPC_BATCH_LANES];
+
+        for(f=0; f+LDPC_BATCH_LANES<=nframes; f+=LDPC_BATCH_LANES)
+            decode_batch_avx2(&llrs[f*N], &out[f*(K/8)], &ok[f]);
+
+        /* Fill the spare lanes of a final partial batch with a certain
+         * all-zeros codeword, which decodes immediately.
+         */
+        if(f < nframes) {
+            for(lane=0; lane<LDPC_BATCH_LANES; lane++) {
+                if(f + lane < nframes)
+                    memcpy(pad[lane], &llrs[(f+lane)*N], sizeof(pad[lane]));
+                else
+                    for(a=0; a<N; a++)
+                        pad[lane][a] = 100.0f;
+                pad_ok[lane] = false;
+            }
+            memset(pad_out, 0, sizeof(pad_out));
+            decode_batch_avx2(&pad[0][0], &pad_out[0][0], pad_ok);
+            for(lane=0; f+lane<nframes; lane++) {
+                memcpy(&out[(f+lane)*(K/8)], pad_out[lane], K/8);
+                ok[f+lane] = pad_ok[lane];
+            }
         }
+    } else
+#endif
+    {
+        for(f=0; f<nframes; f++)
+            ok[f] = decode_batch_scalar(&llrs[f*N], &out[f*(K/8)]);
     }
 
-    /* If we hit the iteration limit, we failed to decode. */
-    return false;
+    for(f=0; f<nframes; f++)
+        if(ok[f])
+            n_ok++;
+    return n_ok;
 }
@@ -3,16 +3,106 @@
 #ifndef _LDPC_DECODER_H_
 #define _LDPC_DECODER_H_
 
+#include <stddef.h>
 #include <stdint.h>
 #include "parity_matrix.h"
 
+/* Decoding algorithms, selected with `ldpc_set_mode`.
+ *
+ * LDPC_MODE_FLOODING_SPA updates every check node and then every variable
+ * node each iteration, using the exact tanh/atanh sum-product rule.
+ *
+ * LDPC_MODE_LAYERED_NMS and LDPC_MODE_LAYERED_OMS process one row of H at a
+ * time, updating the marginals immediately so later rows in the same
+ * iteration see the new information, which roughly halves the iterations
+ * needed. Check nodes use min-sum, corrected either by scaling the minimum
+ * (normalised) or by subtracting a constant from it (offset).
+ *
+ * LDPC_MODE_LAYERED_NMS_FIXED is layered normalised min-sum on quantised
+ * LLRs with saturating LDPC_FIXED_BITS bit messages (see ldpc_fixed.h).
+ * It is the fastest single frame decoder and the default.
+ */
+typedef enum {
+    LDPC_MODE_FLOODING_SPA,
+    LDPC_MODE_LAYERED_NMS,
+    LDPC_MODE_LAYERED_OMS,
+    LDPC_MODE_LAYERED_NMS_FIXED,
+} ldpc_mode;
+
+/* Statistics about one decode, for measuring convergence. */
+typedef struct {
+    /* Number of iterations run before the decoder stopped. */
+    int iterations;
+
+    /* Unsatisfied parity checks in the hard decision of the channel LLRs. */
+    int initial_syndrome_weight;
+
+    /* Unsatisfied parity checks when the decoder stopped, 0 on success. */
+    int syndrome_weight;
+} ldpc_stats;
+
 /* Initialise the LDPC decoder. Call once at startup. */
 void ldpc_init(void);
 
+/* Select the algorithm used by subsequent calls to `ldpc_decode`.
+ * Defaults to LDPC_MODE_LAYERED_NMS_FIXED.
+ */
+void ldpc_set_mode(ldpc_mode mode);
+
+/* Set the quantiser used by LDPC_MODE_LAYERED_NMS_FIXED in subsequent
+ * calls to `ldpc_decode`: LLRs are multiplied by `scale`, rounded and
+ * saturated to the message range. Defaults to LDPC_FIXED_DEFAULT_SCALE.
+ */
+void ldpc_set_quantizer(double scale);
+
 /* Decode a message from the LLRs in `llrs`, where positive values are more
  * likely to be 0, and write the result in `out` as packed bytes, MSb first.
- * Returns true on success and false on failure.
+ * Returns true on success and false on failure, in which case `out` holds
+ * the hard decision of the final iteration.
  */
 extern bool ldpc_decode(double llrs[N], uint8_t out[K/8]);
 
+/* As `ldpc_decode`, also filling in `stats` unless it is NULL. */
+bool ldpc_decode_stats(double llrs[N], uint8_t out[K/8], ldpc_stats* stats);
+
+/* A decoder context owns a copy of the parity structure and the message
+ * workspace for one decode at a time. Decoding with a context never
+ * allocates, and separate contexts can decode concurrently, one per thread.
+ */
+typedef struct ldpc_ctx ldpc_ctx;
+
+/* Allocate a context decoding with `mode`. Call ldpc_init first.
+ * Returns NULL if out of memory.
+ */
+ldpc_ctx* ldpc_ctx_new(ldpc_mode mode);
+
+/* Free a context from `ldpc_ctx_new`. */
+void ldpc_ctx_free(ldpc_ctx* ctx);
+
+/* Select the algorithm used by subsequent decodes with `ctx`. */
+void ldpc_ctx_set_mode(ldpc_ctx* ctx, ldpc_mode mode);
+
+/* Set the quantiser scale used by subsequent fixed-point decodes with `ctx`. */
+void ldpc_ctx_set_quantizer(ldpc_ctx* ctx, double scale);
+
+/* As `ldpc_decode_stats`, using the context `ctx`. */
+bool ldpc_ctx_decode(ldpc_ctx* ctx, const double llrs[N], uint8_t out[K/8],
+                     ldpc_stats* stats);
+
+/* Number of frames decoded in parallel by `ldpc_decode_batch`. */
+#define LDPC_BATCH_LANES (8)
+
+/* Decode `nframes` frames, each of N LLRs stored consecutively in `llrs`,
+ * always using layered normalised min-sum. The decoded messages are written
+ * K/8 bytes per frame to `out`, and `ok[f]` is set true if frame f decoded.
+ * Frames that fail to decode get the final hard decision on their message
+ * bits, as with `ldpc_decode`.
+ * Returns the number of frames successfully decoded.
+ *
+ * On CPUs with AVX2, LDPC_BATCH_LANES frames are decoded together, one per
+ * SIMD lane. Otherwise each frame is decoded in turn.
+ */
+size_t ldpc_decode_batch(const float* llrs, size_t nframes,
+                         uint8_t* out, bool* ok);
+
 #endif /* _LDPC_DECODER_H_ */
@@ -0,0 +1,131 @@
+#include <math.h>
+#include "ldpc_fixed.h"
+
+/* Maximum number of iterations to attempt to decode a message for. */
+#define MAX_ITERS (100)
+
+static inline ldpc_fixed_msg sat_msg(int32_t x)
+{
+    if(x > LDPC_FIXED_MSG_MAX)
+        return LDPC_FIXED_MSG_MAX;
+    if(x < -LDPC_FIXED_MSG_MAX)
+        return -LDPC_FIXED_MSG_MAX;
+    return x;
+}
+
+/* Saturate a sum of marginals and messages to the marginal range. */
+static inline ldpc_fixed_acc sat_acc(int32_t x)
+{
+    if(x > LDPC_FIXED_ACC_MAX)
+        return LDPC_FIXED_ACC_MAX;
+    if(x < -LDPC_FIXED_ACC_MAX)
+        return -LDPC_FIXED_ACC_MAX;
+    return x;
+}
+
+void ldpc_fixed_quantize(const double* llrs, ldpc_fixed_msg* out, int n,
+                         double scale)
+{
+    int i;
+
+    for(i=0; i<n; i++) {
+        double x = llrs[i] * scale;
+        if(x >= LDPC_FIXED_MSG_MAX)
+            out[i] = LDPC_FIXED_MSG_MAX;
+        else if(x <= -LDPC_FIXED_MSG_MAX)
+            out[i] = -LDPC_FIXED_MSG_MAX;
+        else
+            out[i] = (ldpc_fixed_msg)lrint(x);
+    }
+}
+
+/* Hard decide the marginals `r`, pack the message bits into `out`, and
+ * check the syndrome as in the floating point decoder.
+ */
+static bool check_codeword(const parity_graph* g, const ldpc_fixed_acc r[N],
+                           uint8_t out[K/8], int iter, ldpc_stats* stats)
+{
+    uint64_t hard[N/64];
+    int i, w, b, weight;
+
+    for(w=0; w<N/64; w++) {
+        uint64_t word = 0;
+        for(b=0; b<64; b++)
+            word = (word << 1) | (r[w*64 + b] <= 0);
+        hard[w] = word;
+    }
+    weight = parity_graph_syndrome_weight(g, hard);
+
+    if(iter == 0)
+        stats->initial_syndrome_weight = weight;
+    stats->iterations = iter;
+    stats->syndrome_weight = weight;
+
+    for(i=0; i<K/8; i++)
+        out[i] = hard[i/8] >> (56 - 8*(i % 8));
+    return weight == 0;
+}
+
+/* Layered normalised min-sum as in ldpc_decoder.c, with the check
+ * messages scaled by 3/4, rounding to nearest, with a shift.
+ *
+ * Only the stored check messages u are saturated to the message range.
+ * The variable messages q = r - u stay at the marginal width, so a large
+ * marginal keeps its channel LLR when the row's message is swapped; if q
+ * were clipped too, strongly decided bits would lose their channel
+ * information and some frames drift to the all-ones codeword.
+ */
+bool ldpc_fixed_decode(const parity_graph* g, ldpc_fixed_workspace* ws,
+                       const ldpc_fixed_msg llrs[N], uint8_t out[K/8],
+                       ldpc_stats* stats)
+{
+    ldpc_fixed_msg* u = ws->u;
+    ldpc_fixed_acc* q = ws->q;
+    ldpc_fixed_acc* r = ws->r;
+    ldpc_fixed_msg min1, min2, mag, m1, m2;
+    ldpc_stats unused;
+    int iter, i, a, e, min_e, sgn;
+
+    if(stats == NULL)
+        stats = &unused;
+
+    for(a=0; a<N; a++)
+        r[a] = llrs[a];
+
+    for(e=0; e<E; e++)
+        u[e] = 0;
+
+    for(iter=0; iter<MAX_ITERS; iter++) {
+        if(check_codeword(g, r, out, iter, stats))
+            return true;
+
+        for(i=0; i<K; i++) {
+            min1 = min2 = LDPC_FIXED_MSG_MAX;
+            min_e = 0;
+            sgn = 0;
+            for(e=g->row_start[i]; e<g->row_start[i+1]; e++) {
+                q[e] = sat_acc((int32_t)r[g->edge_col[e]] - u[e]);
+                mag = sat_msg(q[e] < 0 ? -q[e] : q[e]);
+                sgn ^= q[e] < 0;
+                if(mag < min1) {
+                    min2 = min1;
+                    min1 = mag;
+                    min_e = e;
+                } else if(mag < min2) {
+                    min2 = mag;
+                }
+            }
+
+            m1 = (3 * min1 + 2) >> 2;
+            m2 = (3 * min2 + 2) >> 2;
+
+            for(e=g->row_start[i]; e<g->row_start[i+1]; e++) {
+                mag = (e == min_e) ? m2 : m1;
+                u[e] = (sgn ^ (q[e] < 0)) ? -mag : mag;
+                r[g->edge_col[e]] = sat_acc((int32_t)q[e] + u[e]);
+            }
+        }
+    }
+
+    return check_codeword(g, r, out, MAX_ITERS, stats);
+}
@@ -0,0 +1,66 @@
+/* Fixed-point LDPC decoder
+ *
+ * Layered normalised min-sum with saturating integer messages. It only
+ * needs a parity_graph and a workspace, does no allocation and uses no
+ * floating point once the LLRs are quantised, so it also builds for the
+ * flight MCUs.
+ */
+
+#ifndef _LDPC_FIXED_H_
+#define _LDPC_FIXED_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "parity_matrix.h"
+#include "ldpc_decoder.h"
+
+/* Message width in bits, 8 or 16. Marginals are kept at twice the width,
+ * and for 16 bit messages limited to half the int32 range, so every sum
+ * of a marginal and a message fits in an int32_t.
+ */
+#ifndef LDPC_FIXED_BITS
+#define LDPC_FIXED_BITS (8)
+#endif
+
+#if LDPC_FIXED_BITS == 8
+typedef int8_t ldpc_fixed_msg;
+typedef int16_t ldpc_fixed_acc;
+#define LDPC_FIXED_MSG_MAX (INT8_MAX)
+#define LDPC_FIXED_ACC_MAX (INT16_MAX)
+/* Quantisation steps per unit LLR used unless told otherwise. */
+#define LDPC_FIXED_DEFAULT_SCALE (8.0)
+#elif LDPC_FIXED_BITS == 16
+typedef int16_t ldpc_fixed_msg;
+typedef int32_t ldpc_fixed_acc;
+#define LDPC_FIXED_MSG_MAX (INT16_MAX)
+#define LDPC_FIXED_ACC_MAX (INT32_MAX / 2)
+#define LDPC_FIXED_DEFAULT_SCALE (256.0)
+#else
+#error "LDPC_FIXED_BITS must be 8 or 16"
+#endif
+
+/* Message storage for one fixed-point decode. */
+typedef struct {
+    ldpc_fixed_msg u[E];
+    ldpc_fixed_acc q[E];
+    ldpc_fixed_acc r[N];
+} ldpc_fixed_workspace;
+
+/* Quantise `n` LLRs to fixed point, multiplying by `scale` and rounding,
+ * then saturating to +-LDPC_FIXED_MSG_MAX. A larger scale gives finer
+ * steps but clips large LLRs sooner.
+ */
+void ldpc_fixed_quantize(const double* llrs, ldpc_fixed_msg* out, int n,
+                         double scale);
+
+/* Decode quantised LLRs with layered normalised min-sum, using the parity
+ * structure `g` and messages in `ws`, and write the message bits MSb first
+ * to `out`. Fills in `stats` unless it is NULL.
+ * Returns true on success and false on failure, in which case `out` holds
+ * the hard decision of the final iteration.
+ */
+bool ldpc_fixed_decode(const parity_graph* g, ldpc_fixed_workspace* ws,
+                       const ldpc_fixed_msg llrs[N], uint8_t out[K/8],
+                       ldpc_stats* stats);
+
+#endif /* _LDPC_FIXED_H_ */
@@ -0,0 +1,325 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <math.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "ldpc_stream.h"
+
+/* Synchroniser states: searching every position for the ASM, copying out
+ * the codeword after an ASM, or checking for the next ASM where a locked
+ * stream should have it.
+ */
+typedef enum {
+    SYNC_SEARCH,
+    SYNC_FRAME,
+    SYNC_CHECK,
+} sync_state;
+
+/* Queue slot states. A slot is filled by the pushing thread while EMPTY,
+ * then passes to the workers, and is EMPTY again once emitted.
+ */
+typedef enum {
+    SLOT_EMPTY,
+    SLOT_QUEUED,
+    SLOT_DECODING,
+    SLOT_DONE,
+} slot_state;
+
+typedef struct {
+    slot_state state;
+    float llrs[N];
+    double t_ready;
+    TelemPacket pkt;
+    ldpc_stream_frame frame;
+} stream_slot;
+
+typedef struct {
+    ldpc_stream* s;
+    ldpc_ctx* ctx;
+    pthread_t thread;
+} stream_worker;
+
+struct ldpc_stream {
+    /* Synchroniser state, only used by the pushing thread. The last
+     * LDPC_STREAM_ASM_BITS LLRs are written twice into `window`, so the
+     * newest LDPC_STREAM_ASM_BITS always sit contiguously from win_pos,
+     * and asm_sign holds the correlator weights.
+     */
+    sync_state sync;
+    float window[2*LDPC_STREAM_ASM_BITS];
+    int win_pos, win_fill;
+    uint64_t pos;
+    float asm_sign[LDPC_STREAM_ASM_BITS];
+    stream_slot* filling;
+    int fill;
+    bool inverted;
+
+    /* Frame seq lives in slots[seq % queue_len]. Frames before `tail` have
+     * been emitted, from `tail` up to `next_decode` are being decoded or
+     * waiting to be emitted, and from there up to `head` are queued.
+     */
+    int queue_len;
+    stream_slot* slots;
+    uint64_t head, next_decode, tail;
+    bool stop;
+    pthread_mutex_t lock;
+    pthread_cond_t not_full, work, emitted;
+
+    int n_workers;
+    stream_worker* workers;
+    ldpc_stream_cb cb;
+    void* user;
+};
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Soft correlation metric of the window against the ASM, in [-1, 1]. */
+static double correlate(const ldpc_stream* s)
+{
+    const float* w = &s->window[s->win_pos];
+    float c = 0.0f, a = 0.0f;
+    int j;
+
+    for(j=0; j<LDPC_STREAM_ASM_BITS; j++) {
+        c += s->asm_sign[j] * w[j];
+        a += fabsf(w[j]);
+    }
+    return a > 0.0f ? c / a : 0.0;
+}
+
+static void window_push(ldpc_stream* s, float x)
+{
+    s->window[s->win_pos] = x;
+    s->window[s->win_pos + LDPC_STREAM_ASM_BITS] = x;
+    s->win_pos = (s->win_pos + 1) % LDPC_STREAM_ASM_BITS;
+    if(s->win_fill < LDPC_STREAM_ASM_BITS)
+        s->win_fill++;
+}
+
+/* Take the next free slot for a frame starting after the current LLR,
+ * waiting for the workers to free one if the queue is full.
+ */
+static void start_frame(ldpc_stream* s, double metric)
+{
+    stream_slot* slot;
+
+    pthread_mutex_lock(&s->lock);
+    while(s->head - s->tail >= (uint64_t)s->queue_len)
+        pthread_cond_wait(&s->not_full, &s->lock);
+    pthread_mutex_unlock(&s->lock);
+
+    slot = &s->slots[s->head % s->queue_len];
+    slot->frame.seq = s->head;
+    slot->frame.offset = s->pos + 1;
+    slot->frame.sync_metric = fabs(metric);
+    slot->frame.inverted = metric < 0.0;
+    s->filling = slot;
+    s->fill = 0;
+    s->inverted = metric < 0.0;
+    s->sync = SYNC_FRAME;
+}
+
+/* Hand the filled slot to the workers. */
+static void queue_frame(ldpc_stream* s)
+{
+    pthread_mutex_lock(&s->lock);
+    s->filling->t_ready = now();
+    s->filling->state = SLOT_QUEUED;
+    s->head++;
+    pthread_cond_signal(&s->work);
+    pthread_mutex_unlock(&s->lock);
+    s->filling = NULL;
+}
+
+void ldpc_stream_push(ldpc_stream* s, const float* llrs, size_t n)
+{
+    size_t i;
+    double metric;
+
+    for(i=0; i<n; i++, s->pos++) {
+        switch(s->sync) {
+            case SYNC_SEARCH:
+                window_push(s, llrs[i]);
+                if(s->win_fill < LDPC_STREAM_ASM_BITS)
+                    break;
+                metric = correlate(s);
+                if(fabs(metric) >= LDPC_STREAM_SEARCH_THRESHOLD)
+                    start_frame(s, metric);
+                break;
+
+            case SYNC_FRAME:
+                s->filling->llrs[s->fill++] = llrs[i];
+                if(s->fill == N) {
+                    queue_frame(s);
+                    s->sync = SYNC_CHECK;
+                    s->win_fill = 0;
+                }
+                break;
+
+            case SYNC_CHECK:
+                window_push(s, llrs[i]);
+                if(s->win_fill < LDPC_STREAM_ASM_BITS)
+                    break;
+                metric = correlate(s);
+                /* Keep lock only with the same polarity as the last ASM. */
+                if((s->inverted ? -metric : metric) >=
+                   LDPC_STREAM_LOCK_THRESHOLD)
+                    start_frame(s, metric);
+                else
+                    s->sync = SYNC_SEARCH;
+                break;
+        }
+    }
+}
+
+/* Emit every frame that is next in order and decoded. Call with the lock
+ * held; holding it throughout keeps the callbacks in order.
+ */
+static void emit_ready(ldpc_stream* s)
+{
+    stream_slot* slot;
+    double t = now();
+
+    while(s->tail != s->next_decode) {
+        slot = &s->slots[s->tail % s->queue_len];
+        if(slot->state != SLOT_DONE)
+            break;
+        slot->frame.latency = t - slot->t_ready;
+        s->cb(&slot->pkt, &slot->frame, s->user);
+        slot->state = SLOT_EMPTY;
+        s->tail++;
+        pthread_cond_signal(&s->not_full);
+        pthread_cond_broadcast(&s->emitted);
+    }
+}
+
+static void* worker_main(void* arg)
+{
+    stream_worker* w = arg;
+    ldpc_stream* s = w->s;
+    stream_slot* slot;
+    double llrs[N];
+    uint8_t out[K/8];
+    int a;
+
+    pthread_mutex_lock(&s->lock);
+    for(;;) {
+        while(!s->stop && s->next_decode == s->head)
+            pthread_cond_wait(&s->work, &s->lock);
+        if(s->next_decode == s->head)
+            break;
+
+        slot = &s->slots[s->next_decode++ % s->queue_len];
+        slot->state = SLOT_DECODING;
+        pthread_mutex_unlock(&s->lock);
+
+        for(a=0; a<N; a++)
+            llrs[a] = slot->frame.inverted ? -slot->llrs[a] : slot->llrs[a];
+        slot->frame.decoded = ldpc_ctx_decode(w->ctx, llrs, out,
+                                              &slot->frame.stats);
+        memcpy(&slot->pkt, out, sizeof(slot->pkt));
+
+        pthread_mutex_lock(&s->lock);
+        slot->state = SLOT_DONE;
+        emit_ready(s);
+    }
+    pthread_mutex_unlock(&s->lock);
+
+    return NULL;
+}
+
+ldpc_stream* ldpc_stream_new(int threads, int queue_len, ldpc_mode mode,
+                             ldpc_stream_cb cb, void* user)
+{
+    ldpc_stream* s;
+    int i, j;
+
+    if(threads < 1 || queue_len < 1)
+        return NULL;
+
+    s = calloc(1, sizeof(ldpc_stream));
+    if(s == NULL)
+        return NULL;
+
+    /* Weight ASM bit j by +1 for a 0 and -1 for a 1. */
+    for(j=0; j<LDPC_STREAM_ASM_BITS; j++)
+        s->asm_sign[j] = (LDPC_STREAM_ASM >> (LDPC_STREAM_ASM_BITS - 1 - j))
+                         & 1 ? -1.0f : 1.0f;
+    s->sync = SYNC_SEARCH;
+    s->queue_len = queue_len;
+    s->cb = cb;
+    s->user = user;
+    s->slots = calloc(queue_len, sizeof(stream_slot));
+    s->workers = calloc(threads, sizeof(stream_worker));
+    if(s->slots == NULL || s->workers == NULL) {
+        free(s->slots);
+        free(s->workers);
+        free(s);
+        return NULL;
+    }
+
+    pthread_mutex_init(&s->lock, NULL);
+    pthread_cond_init(&s->not_full, NULL);
+    pthread_cond_init(&s->work, NULL);
+    pthread_cond_init(&s->emitted, NULL);
+
+    for(i=0; i<threads; i++) {
+        s->workers[i].s = s;
+        s->workers[i].ctx = ldpc_ctx_new(mode);
+        if(s->workers[i].ctx == NULL ||
+           pthread_create(&s->workers[i].thread, NULL, worker_main,
+                          &s->workers[i]) != 0) {
+            ldpc_ctx_free(s->workers[i].ctx);
+            break;
+        }
+        s->n_workers++;
+    }
+
+    if(s->n_workers != threads) {
+        ldpc_stream_free(s);
+        return NULL;
+    }
+
+    return s;
+}
+
+void ldpc_stream_flush(ldpc_stream* s)
+{
+    pthread_mutex_lock(&s->lock);
+    while(s->tail != s->head)
+        pthread_cond_wait(&s->emitted, &s->lock);
+    pthread_mutex_unlock(&s->lock);
+}
+
+void ldpc_stream_free(ldpc_stream* s)
+{
+    int i;
+
+    if(s->n_workers > 0)
+        ldpc_stream_flush(s);
+
+    pthread_mutex_lock(&s->lock);
+    s->stop = true;
+    pthread_cond_broadcast(&s->work);
+    pthread_mutex_unlock(&s->lock);
+
+    for(i=0; i<s->n_workers; i++) {
+        pthread_join(s->workers[i].thread, NULL);
+        ldpc_ctx_free(s->workers[i].ctx);
+    }
+
+    pthread_cond_destroy(&s->emitted);
+    pthread_cond_destroy(&s->work);
+    pthread_cond_destroy(&s->not_full);
+    pthread_mutex_destroy(&s->lock);
+    free(s->workers);
+    free(s->slots);
+    free(s);
+}
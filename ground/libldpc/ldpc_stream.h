@@ -0,0 +1,94 @@
+/* Streaming frame synchroniser and decode pipeline
+ *
+ * Turns a continuous stream of soft symbols into decoded TelemPackets.
+ * Each frame on air is the 32 bit CCSDS attached sync marker (ASM)
+ * followed by one N bit codeword whose K message bits are one TelemPacket.
+ *
+ * LLRs are pushed in buffers of any length. A soft correlator searches
+ * for the ASM, then slices out the codeword after it and checks for the
+ * next ASM straight after that, dropping back to searching if it is not
+ * there. Sliced frames go into a bounded queue decoded by a pool of worker
+ * threads, each with its own ldpc_ctx, and are handed back in stream order.
+ */
+
+#ifndef _LDPC_STREAM_H_
+#define _LDPC_STREAM_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "ldpc_decoder.h"
+#include "m2telem.h"
+
+/* Attached sync marker, sent MSb first, and its length in bits. */
+#define LDPC_STREAM_ASM      (0x1ACFFC1DUL)
+#define LDPC_STREAM_ASM_BITS (32)
+
+/* The soft correlation metric is sum(s_j * llr_j) / sum(|llr_j|) over the
+ * ASM, with s_j = +1 for a 0 bit and -1 for a 1 bit, so 1.0 is a perfect
+ * match and random data averages 0. A sign flipped stream, as from a BPSK
+ * demodulator locked 180 degrees out, correlates towards -1 and is
+ * inverted before decoding.
+ *
+ * LDPC_STREAM_SEARCH_THRESHOLD must be met to acquire a frame anywhere in
+ * the stream, and the lower LDPC_STREAM_LOCK_THRESHOLD to keep lock where
+ * the next ASM is expected.
+ */
+#define LDPC_STREAM_SEARCH_THRESHOLD (0.80)
+#define LDPC_STREAM_LOCK_THRESHOLD   (0.40)
+
+/* Details of one frame, passed along with its packet. */
+typedef struct {
+    /* Frame number, counting from 0 in stream order. */
+    uint64_t seq;
+
+    /* Index in the stream of the first LLR of the codeword. */
+    uint64_t offset;
+
+    /* Magnitude of the ASM correlation metric, and whether the frame
+     * correlated negatively and was inverted.
+     */
+    double sync_metric;
+    bool inverted;
+
+    /* True if the codeword decoded, and the decoder's statistics. */
+    bool decoded;
+    ldpc_stats stats;
+
+    /* Seconds from the frame's last LLR being pushed to it being emitted. */
+    double latency;
+} ldpc_stream_frame;
+
+/* Called once per frame, strictly in stream order, with the decoded packet.
+ * Frames that failed to decode are passed too, with frame->decoded false
+ * and the packet holding the decoder's final hard decision.
+ *
+ * Runs on one of the worker threads with the stream's lock held, so it
+ * should be quick and must not call back into the stream.
+ */
+typedef void (*ldpc_stream_cb)(const TelemPacket* pkt,
+                               const ldpc_stream_frame* frame, void* user);
+
+typedef struct ldpc_stream ldpc_stream;
+
+/* Create a stream decoding with `mode` on `threads` worker threads, with
+ * at most `queue_len` frames queued or being decoded at once, calling
+ * `cb` with `user` for each frame. Call ldpc_init first.
+ * Returns NULL if `threads` or `queue_len` is less than 1, if out of memory
+ * or if the threads cannot be started.
+ */
+ldpc_stream* ldpc_stream_new(int threads, int queue_len, ldpc_mode mode,
+                             ldpc_stream_cb cb, void* user);
+
+/* Feed `n` more LLRs to the stream, positive values meaning 0 is more
+ * likely. Blocks while the queue is full.
+ */
+void ldpc_stream_push(ldpc_stream* s, const float* llrs, size_t n);
+
+/* Wait until every frame sliced so far has been emitted. */
+void ldpc_stream_flush(ldpc_stream* s);
+
+/* Flush the stream, stop its workers and free it. */
+void ldpc_stream_free(ldpc_stream* s);
+
+#endif /* _LDPC_STREAM_H_ */
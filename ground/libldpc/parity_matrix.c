@@ -1,130 +1,199 @@
+#include <assert.h>
+#include <string.h>
 #include "parity_matrix.h"
 
-/* Size of parity matrix component blocks */
-#define M (32)
+/* Shorthand for the blocks of a code, as in CCSDS 231.1-O-1:
+ * Z is 0_M, I is I_M, P(n) is Phi_M(n) and S(n) is I_M + Phi_M(n).
+ */
+#define Z    {PARITY_NO_SHIFT, PARITY_NO_SHIFT}
+#define I    {0, PARITY_NO_SHIFT}
+#define P(n) {n, PARITY_NO_SHIFT}
+#define S(n) {0, n}
+
+const parity_code parity_code_256_128 = {
+    32,
+    {
+        {S(31), P(15), P(25), P(0) , Z    , P(20), P(12), I    },
+        {P(28), S(30), P(29), P(24), I    , Z    , P(1) , P(20)},
+        {P(8) , P(0) , S(28), P(1) , P(29), I    , Z    , P(21)},
+        {P(18), P(30), P(0) , S(30), P(25), P(26), I    , Z    }
+    }
+};
 
-/* Blocks per row */
-#define BR (K/M)
+#undef Z
+#undef I
+#undef P
+#undef S
 
-/* Blocks per column */
-#define BC (N/M)
+/* Storage for the expanded representations. */
+uint16_t parity_row_start[K+1];
+uint16_t parity_edge_col[E];
+uint16_t parity_col_start[N+1];
+uint16_t parity_col_edges[E];
+uint64_t parity_Hp[K][N/64];
 
-/* Storage for H and connection representation. */
-bool parity_H[K][N];
-int parity_row_degs[K];
-int parity_row_cons[K][N];
-int parity_col_degs[N];
-int parity_col_cons[N][K];
+int parity_code_row(const parity_code* code, int row, uint16_t* cols)
+{
+    int m = code->m, x = row % m, a, s, deg = 0;
+    const int16_t (*blocks)[PARITY_BLOCK_SHIFTS] = code->shifts[row / m];
 
-/* Store a sub-block.
- * Mainly used so functions can return sub-blocks.
- */
-typedef struct {
-    bool h[M][M];
-} Block;
+    /* Row x of Phi_m(s) has its one in column (x + s) mod m. Blocks cover
+     * ascending column ranges, so only each block's own columns need
+     * sorting, and a shift repeated within a block cancels mod 2.
+     */
+    for(a=0; a<PARITY_BLOCK_COLS; a++) {
+        int n = 0, block_cols[PARITY_BLOCK_SHIFTS], i, j;
+
+        for(s=0; s<PARITY_BLOCK_SHIFTS; s++) {
+            int col;
+            if(blocks[a][s] == PARITY_NO_SHIFT)
+                continue;
+            col = (x + blocks[a][s]) % m;
+            for(i=0; i<n && block_cols[i]<col; i++);
+            if(i < n && block_cols[i] == col) {
+                for(j=i; j<n-1; j++)
+                    block_cols[j] = block_cols[j+1];
+                n--;
+                continue;
+            }
+            for(j=n; j>i; j--)
+                block_cols[j] = block_cols[j-1];
+            block_cols[i] = col;
+            n++;
+        }
+
+        for(i=0; i<n; i++)
+            cols[deg++] = a*m + block_cols[i];
+    }
+
+    return deg;
+}
 
-/* Generate 0_M, the all-zeros block. */
-static Block z()
+int parity_code_edges(const parity_code* code)
 {
-    int i, j;
-    Block b;
-    for(i=0; i<M; i++)
-        for(j=0; j<M; j++)
-            b.h[i][j] = 0;
-    return b;
+    uint16_t cols[PARITY_BLOCK_COLS * PARITY_BLOCK_SHIFTS];
+    int i, e = 0;
+
+    for(i=0; i<PARITY_CODE_K(code->m); i++)
+        e += parity_code_row(code, i, cols);
+    return e;
 }
 
-/* Generate Phi_M(N), the nth right circular shift of the MxM identity matrix.
- */
-static Block p(int n)
+bool parity_code_expand(const parity_code* code, int max_edges,
+                        uint16_t* row_start, uint16_t* edge_col,
+                        uint16_t* col_start, uint16_t* col_edges,
+                        uint64_t* Hp)
+{
+    const int k = PARITY_CODE_K(code->m), n = PARITY_CODE_N(code->m);
+    const int words = n / 64;
+    int i, a, e, deg, idx;
+
+    if(parity_code_edges(code) > max_edges)
+        return false;
+
+    /* Edges are numbered row by row, and packed rows set as they go. */
+    e = 0;
+    for(i=0; i<k; i++) {
+        row_start[i] = e;
+        deg = parity_code_row(code, i, &edge_col[e]);
+        for(a=0; a<words; a++)
+            Hp[i*words + a] = 0;
+        for(idx=e; idx<e+deg; idx++)
+            Hp[i*words + edge_col[idx]/64] |=
+                1ULL << (63 - (edge_col[idx] % 64));
+        e += deg;
+    }
+    row_start[k] = e;
+
+    /* Count each column's degree into col_start[a+1], sum them into start
+     * offsets, then place every edge in its column. Edges are visited in
+     * row order, so each column lists its edges by ascending row.
+     */
+    for(a=0; a<=n; a++)
+        col_start[a] = 0;
+    for(idx=0; idx<e; idx++)
+        col_start[edge_col[idx] + 1]++;
+    for(a=0; a<n; a++)
+        col_start[a+1] += col_start[a];
+    for(idx=0; idx<e; idx++)
+        col_edges[col_start[edge_col[idx]]++] = idx;
+
+    /* Placing the edges advanced each start to the next column's start,
+     * so shift them back by one column.
+     */
+    for(a=n; a>0; a--)
+        col_start[a] = col_start[a-1];
+    col_start[0] = 0;
+    return true;
+}
+
+void parity_matrix_init()
 {
-    int i, j;
-    Block b;
-    for(i=0; i<M; i++)
-        for(j=0; j<M; j++)
-            b.h[i][j] = (j == (i + n) % M);
-    return b;
+    bool ok;
+
+    /* The edge arrays are sized by E, which must match the code's table. */
+    assert(parity_code_edges(&parity_code_256_128) == E);
+    ok = parity_code_expand(&parity_code_256_128, E, parity_row_start,
+                            parity_edge_col, parity_col_start,
+                            parity_col_edges, &parity_Hp[0][0]);
+    assert(ok);
+    (void)ok;
 }
 
-/* Generate I_M, the MxM identity matrix. */
-static Block e()
+bool parity_matrix_check(double x[N])
 {
-    return p(0);
+    uint64_t hard[N/64];
+    parity_matrix_hard_decision(x, hard);
+    return parity_matrix_syndrome_weight(hard) == 0;
 }
 
-/* Generate I_M + Phi_M(n) mod 2. */
-static Block s(int n)
+void parity_matrix_hard_decision(const double x[N], uint64_t hard[N/64])
 {
-    int i, j;
-    Block eye = e(), phi = p(n), b;
-    for(i=0; i<M; i++)
-        for(j=0; j<M; j++)
-            b.h[i][j] = phi.h[i][j] ^ eye.h[i][j];
-    return b;
+    int w, b;
+
+    for(w=0; w<N/64; w++) {
+        uint64_t word = 0;
+        for(b=0; b<64; b++)
+            word = (word << 1) | (x[w*64 + b] <= 0.0);
+        hard[w] = word;
+    }
 }
 
-void parity_matrix_init()
+static int syndrome_weight(const uint64_t Hp[K][N/64],
+                           const uint64_t hard[N/64])
 {
-    /* Parity check definition by sub-block from H_128x256,
-     * defined in CCSDS 231.1-O-1 p2-2.
+    int i, w, weight = 0;
+
+    /* Each check's parity is the parity of the number of hard-decoded ones
+     * it covers, so AND the row with the hard decision, XOR the words
+     * together and take the parity of the popcount.
      */
-    Block subblocks[BR][BC] = {
-        {s(31), p(15), p(25), p(0) , z()  , p(20), p(12), e()  },
-        {p(28), s(30), p(29), p(24), e()  , z()  , p(1) , p(20)},
-        {p(8) , p(0),  s(28), p(1) , p(29), e()  , z()  , p(21)},
-        {p(18), p(30), p(0) , s(30), p(25), p(26), e()  , z()  }
-    };
-
-    /* Build up H from the sub-blocks in h. */
-    int i, a, x, y;
-    for(i=0; i<BR; i++)
-        for(a=0; a<BC; a++)
-            for(x=0; x<M; x++)
-                for(y=0; y<M; y++)
-                    parity_H[i*M + x][a*M + y] = subblocks[i][a].h[x][y];
-
-    /* Compute connection representation. */
     for(i=0; i<K; i++) {
-        parity_row_degs[i] = 0;
-
-        for(a=0; a<N; a++) {
-            if(i==0) parity_col_degs[a] = 0;
-
-            /* If there's a connection, store it in the next slot in the
-             * respective arrays, and then increment the degrees.
-             */
-            if(parity_H[i][a]) {
-                parity_row_cons[i][parity_row_degs[i]] = a;
-                parity_col_cons[a][parity_col_degs[a]] = i;
-                parity_row_degs[i]++;
-                parity_col_degs[a]++;
-            }
-        }
+        uint64_t acc = 0;
+        for(w=0; w<N/64; w++)
+            acc ^= Hp[i][w] & hard[w];
+        weight += __builtin_popcountll(acc) & 1;
     }
+
+    return weight;
 }
 
-bool parity_matrix_check(double x[N])
+int parity_matrix_syndrome_weight(const uint64_t hard[N/64])
 {
-    int i, a, parity;
-
-    /* For each parity check equation */
-    for(i=0; i<K; i++) {
-        parity = 0;
-
-        /* For each code bit */
-        for(a=0; a<N; a++) {
-            /* If the equation covers this bit, and the bit is hard-decoded 1,
-             * then increment parity.
-             */
-            if(parity_H[i][a] && x[a] <= 0.0)
-                parity++;
-        }
+    return syndrome_weight((const uint64_t (*)[N/64])parity_Hp, hard);
+}
 
-        /* Immediately return false when an equation is not satisfied. */
-        if(parity % 2 != 0)
-            return false;
-    }
+void parity_matrix_graph(parity_graph* g)
+{
+    memcpy(g->row_start, parity_row_start, sizeof(g->row_start));
+    memcpy(g->edge_col, parity_edge_col, sizeof(g->edge_col));
+    memcpy(g->col_start, parity_col_start, sizeof(g->col_start));
+    memcpy(g->col_edges, parity_col_edges, sizeof(g->col_edges));
+    memcpy(g->Hp, parity_Hp, sizeof(g->Hp));
+}
 
-    /* If all equations were satisfied then x hard-decodes to a codeword. */
-    return true;
+int parity_graph_syndrome_weight(const parity_graph* g,
+                                 const uint64_t hard[N/64])
+{
+    return syndrome_weight(g->Hp, hard);
 }
@@ -4,28 +4,101 @@
 #define _PARITY_MATRIX_H_
 
 #include <stdbool.h>
+#include <stdint.h>
+
+/* Quasi-cyclic code description.
+ * H is made of PARITY_BLOCK_ROWS x PARITY_BLOCK_COLS square blocks of size
+ * m, and each block is the mod 2 sum of up to PARITY_BLOCK_SHIFTS right
+ * circular shifts of the m x m identity, Phi_m(s). shifts[i][a] lists the
+ * shifts making up block (i, a), with PARITY_NO_SHIFT in unused slots, so
+ * 0_m has none, Phi_m(s) has one and I_m + Phi_m(s) has two.
+ * This is the shape of the rate 1/2 codes in CCSDS 231.1-O-1, which differ
+ * only in m and the shifts, so a code is a few dozen bytes rather than
+ * expanded tables.
+ */
+#define PARITY_BLOCK_ROWS   (4)
+#define PARITY_BLOCK_COLS   (8)
+#define PARITY_BLOCK_SHIFTS (2)
+#define PARITY_NO_SHIFT     (-1)
+
+typedef struct {
+    int m;
+    int16_t shifts[PARITY_BLOCK_ROWS][PARITY_BLOCK_COLS][PARITY_BLOCK_SHIFTS];
+} parity_code;
+
+/* Dimension and length of a code with circulant size m. */
+#define PARITY_CODE_K(m) (PARITY_BLOCK_ROWS * (m))
+#define PARITY_CODE_N(m) (PARITY_BLOCK_COLS * (m))
+
+/* The (256,128) code, H_128x256 in CCSDS 231.1-O-1 p2-2, which is the one
+ * this library decodes.
+ */
+#define PARITY_M (32)
+extern const parity_code parity_code_256_128;
 
 /* Code dimension */
-#define K (128)
+#define K PARITY_CODE_K(PARITY_M)
 
 /* Code length */
-#define N (256)
+#define N PARITY_CODE_N(PARITY_M)
 
-/* Parity matrix */
-extern bool parity_H[K][N];
+/* Number of edges in the Tanner graph, i.e. ones in H, which sizes the
+ * edge arrays below. Must equal parity_code_edges(&parity_code_256_128).
+ */
+#define E (1024)
+
+/* Count the ones in H for `code`, i.e. its number of edges. */
+int parity_code_edges(const parity_code* code);
+
+/* Write the columns connected to `row` of `code` into `cols` in ascending
+ * order, straight from the shifts, and return how many there are.
+ * `cols` needs room for PARITY_BLOCK_COLS * PARITY_BLOCK_SHIFTS entries.
+ */
+int parity_code_row(const parity_code* code, int row, uint16_t* cols);
+
+/* Expand `code` into an edge list and packed rows laid out as below, for
+ * any m: row_start needs k+1 entries, edge_col and col_edges one per edge,
+ * col_start n+1 entries, and Hp k rows of n/64 words (so m a multiple of 8
+ * for the (128,64) code and up). edge_col and col_edges hold `max_edges`
+ * entries; returns false, writing nothing, if the code has more edges.
+ */
+bool parity_code_expand(const parity_code* code, int max_edges,
+                        uint16_t* row_start, uint16_t* edge_col,
+                        uint16_t* col_start, uint16_t* col_edges,
+                        uint64_t* Hp);
 
-/* Alternative representation: arrays of connected indicies.
- * parity_row_degs[i] gives the degree of row i,
- * parity_row_cons[i] is a degree-long array of indices of columns
- *                    that row i is connected to,
- * and likewise for parity_col_degs and parity_col_cons.
+/* Compressed edge list of parity_code_256_128.
+ * Edges are numbered in row order, so row i owns edges
+ * parity_row_start[i] to parity_row_start[i+1]-1, and
+ * parity_edge_col[e] is the column connected by edge e.
+ * parity_col_edges[parity_col_start[a]] to
+ * parity_col_edges[parity_col_start[a+1]-1] are the edges in column a.
+ * Decoders keep one message per edge, so their storage and per-iteration
+ * work scale with E rather than K*N.
  */
-extern int parity_row_degs[K];
-extern int parity_row_cons[K][N];
-extern int parity_col_degs[N];
-extern int parity_col_cons[N][K];
+extern uint16_t parity_row_start[K+1];
+extern uint16_t parity_edge_col[E];
+extern uint16_t parity_col_start[N+1];
+extern uint16_t parity_col_edges[E];
 
-/* Generate the parity matrix. Call once at startup. */
+/* Packed representation: row i of H as four 64 bit words, with column a in
+ * bit 63 - (a % 64) of word a / 64.
+ */
+extern uint64_t parity_Hp[K][N/64];
+
+/* The edge list and packed rows together, which is everything a decoder
+ * needs. Decoder contexts keep their own copy, so each thread decoding
+ * works from memory it owns.
+ */
+typedef struct {
+    uint16_t row_start[K+1];
+    uint16_t edge_col[E];
+    uint16_t col_start[N+1];
+    uint16_t col_edges[E];
+    uint64_t Hp[K][N/64];
+} parity_graph;
+
+/* Expand parity_code_256_128 into the tables above. Call once at startup. */
 void parity_matrix_init(void);
 
 /* Check if x is a codeword (i.e., x.H==0),
@@ -33,4 +106,23 @@ void parity_matrix_init(void);
  */
 bool parity_matrix_check(double x[N]);
 
+/* Hard decide the LLRs in x, packing them in the same layout as parity_Hp
+ * with a 1 wherever x[a] <= 0.
+ */
+void parity_matrix_hard_decision(const double x[N], uint64_t hard[N/64]);
+
+/* Count the parity check equations not satisfied by the hard decision
+ * `hard`, i.e. the weight of the syndrome hard.H^T. Zero for a codeword.
+ */
+int parity_matrix_syndrome_weight(const uint64_t hard[N/64]);
+
+/* Copy the edge list and packed rows into `g`. Call parity_matrix_init
+ * first.
+ */
+void parity_matrix_graph(parity_graph* g);
+
+/* As parity_matrix_syndrome_weight, using the packed rows in `g`. */
+int parity_graph_syndrome_weight(const parity_graph* g,
+                                 const uint64_t hard[N/64]);
+
 #endif /* _PARITY_MATRIX_H_ */
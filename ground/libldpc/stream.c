@@ -0,0 +1,256 @@
+/* LDPC stream decoder
+ *
+ * Decodes a file of float32 LLRs, as written by a demodulator, through
+ * ldpc_stream, checks the packets, and reports the throughput against the
+ * air symbol rate and the latency of each frame through the decoders.
+ *
+ * With -g writes such a file instead: random TelemPackets with increasing
+ * timestamps, each LDPC encoded behind the ASM, sent as BPSK over AWGN in
+ * bursts of back to back frames separated by gaps of noise. A quarter of
+ * the bursts are sign flipped, as from a BPSK demodulator locked 180
+ * degrees out.
+ *
+ * Usage: stream [-t threads] [-q queue] [-m mode] [-b baud] [-v] file
+ *        stream -g frames [-e Eb/N0] [-S seed] file
+ */
+
+#include "ldpc_stream.h"
+#include "ldpc_encoder.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Symbols read and pushed at a time. */
+#define CHUNK (65536)
+
+/* Air frame length: the ASM then one codeword. */
+#define FRAME_SYMBOLS (LDPC_STREAM_ASM_BITS + N)
+
+static uint64_t rng_state = 0x853C49E6748FEA9BULL;
+
+/* xorshift64* uniform on (0, 1]. */
+static double randu(void)
+{
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return ((rng_state * 0x2545F4914F6CDD1DULL) >> 11) * (1.0 / 9007199254740992.0)
+           + (1.0 / 9007199254740992.0);
+}
+
+/* Standard normal by Box-Muller. */
+static double randn(void)
+{
+    return sqrt(-2.0 * log(randu())) * cos(2.0 * M_PI * randu());
+}
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Write `nframes` frames of synthetic stream to `f`. */
+static void generate(FILE* f, long nframes, double ebn0_db)
+{
+    const double sigma = sqrt(1.0 / pow(10.0, ebn0_db / 10.0));
+    const double scale = 2.0 / (sigma * sigma);
+    float sym[FRAME_SYMBOLS];
+    uint8_t coded[N/8];
+    TelemPacket pkt;
+    long frame = 0;
+    int burst, gap, i, j;
+    double polarity;
+
+    while(frame < nframes) {
+        /* Noise, then a burst of up to 64 frames. */
+        gap = (int)(randu() * 1000.0);
+        for(i=0; i<gap; i++) {
+            float x = scale * sigma * randn();
+            fwrite(&x, sizeof(x), 1, f);
+        }
+
+        polarity = randu() < 0.25 ? -1.0 : 1.0;
+        burst = 1 + (int)(randu() * 63.0);
+        for(j=0; j<burst && frame<nframes; j++, frame++) {
+            for(i=0; i<8; i++)
+                pkt.u8[i] = (uint8_t)(randu() * 256.0);
+            pkt.timestamp = (uint32_t)frame;
+            pkt.metadata = M2T_ORIGIN_GROUND << 4;
+            pkt.channel = M2T_CH_SYS_STATS;
+            m2telem_write_checksum(&pkt);
+            ldpc_encode((uint8_t*)&pkt, coded);
+
+            for(i=0; i<FRAME_SYMBOLS; i++) {
+                int bit;
+                if(i < LDPC_STREAM_ASM_BITS)
+                    bit = (LDPC_STREAM_ASM >> (LDPC_STREAM_ASM_BITS-1-i)) & 1;
+                else
+                    bit = (coded[(i - LDPC_STREAM_ASM_BITS) / 8]
+                           >> (7 - (i - LDPC_STREAM_ASM_BITS) % 8)) & 1;
+                sym[i] = polarity * scale * ((bit ? -1.0 : 1.0)
+                                             + sigma * randn());
+            }
+            fwrite(sym, sizeof(float), FRAME_SYMBOLS, f);
+        }
+    }
+
+    /* Trailing noise, so the last frame is followed by something. */
+    for(i=0; i<LDPC_STREAM_ASM_BITS; i++) {
+        float x = scale * sigma * randn();
+        fwrite(&x, sizeof(x), 1, f);
+    }
+}
+
+typedef struct {
+    bool verbose;
+    long frames, decoded, checksum_ok, out_of_order;
+    long max_frames;
+    double* latency;
+    uint32_t last_ts;
+} results;
+
+static void on_frame(const TelemPacket* pkt, const ldpc_stream_frame* frame,
+                     void* user)
+{
+    results* r = user;
+    TelemPacket p = *pkt;
+    bool ok = frame->decoded && m2telem_check_checksum(&p);
+
+    if(r->verbose)
+        printf("%llu\t%llu\t%.3f\t%c\t%d\t%d\t%.1f\t%02X\t%u\n",
+               (unsigned long long)frame->seq,
+               (unsigned long long)frame->offset, frame->sync_metric,
+               frame->inverted ? 'y' : 'n', frame->decoded,
+               frame->stats.iterations, frame->latency * 1e6,
+               p.channel, p.timestamp);
+
+    if(r->frames < r->max_frames)
+        r->latency[r->frames] = frame->latency;
+    r->frames++;
+    r->decoded += frame->decoded;
+    r->checksum_ok += ok;
+    if(ok) {
+        if(r->checksum_ok > 1 && p.timestamp <= r->last_ts)
+            r->out_of_order++;
+        r->last_ts = p.timestamp;
+    }
+}
+
+static int cmp_double(const void* a, const void* b)
+{
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+int main(int argc, char* argv[])
+{
+    int threads = sysconf(_SC_NPROCESSORS_ONLN), queue = 64, opt;
+    long gen_frames = 0;
+    double ebn0_db = 3.0, baud = 150.0, t0, elapsed;
+    ldpc_mode mode = LDPC_MODE_LAYERED_NMS_FIXED;
+    results r;
+    ldpc_stream* s;
+    float* buf;
+    size_t n;
+    uint64_t symbols = 0;
+    long nlat;
+    FILE* f;
+
+    memset(&r, 0, sizeof(r));
+
+    while((opt = getopt(argc, argv, "t:q:m:b:vg:e:S:")) != -1) {
+        switch(opt) {
+            case 't': threads = atoi(optarg); break;
+            case 'q': queue = atoi(optarg); break;
+            case 'm': mode = (ldpc_mode)atoi(optarg); break;
+            case 'b': baud = atof(optarg); break;
+            case 'v': r.verbose = true; break;
+            case 'g': gen_frames = atol(optarg); break;
+            case 'e': ebn0_db = atof(optarg); break;
+            case 'S': rng_state = strtoull(optarg, NULL, 0) | 1; break;
+            default:
+                fprintf(stderr, "Usage: %s [-t threads] [-q queue] [-m mode]"
+                        " [-b baud] [-v] file\n"
+                        "       %s -g frames [-e Eb/N0] [-S seed] file\n",
+                        argv[0], argv[0]);
+                return 1;
+        }
+    }
+    if(optind >= argc || threads < 1 || queue < 1) {
+        fprintf(stderr, "%s: need a file, and at least 1 thread and slot\n",
+                argv[0]);
+        return 1;
+    }
+
+    if(gen_frames > 0) {
+        f = fopen(argv[optind], "wb");
+        if(f == NULL) {
+            perror(argv[optind]);
+            return 1;
+        }
+        generate(f, gen_frames, ebn0_db);
+        fclose(f);
+        return 0;
+    }
+
+    f = fopen(argv[optind], "rb");
+    buf = malloc(CHUNK * sizeof(float));
+    if(f == NULL || buf == NULL) {
+        perror(argv[optind]);
+        return 1;
+    }
+
+    /* Every frame needs at least FRAME_SYMBOLS symbols, which bounds how
+     * many latencies there can be.
+     */
+    fseek(f, 0, SEEK_END);
+    r.max_frames = ftell(f) / sizeof(float) / FRAME_SYMBOLS + 1;
+    fseek(f, 0, SEEK_SET);
+    r.latency = malloc(r.max_frames * sizeof(double));
+
+    ldpc_init();
+    s = ldpc_stream_new(threads, queue, mode, on_frame, &r);
+    if(s == NULL || r.latency == NULL) {
+        fprintf(stderr, "Could not start stream\n");
+        return 1;
+    }
+
+    if(r.verbose)
+        printf("seq\toffset\tsync\tinv\tok\titers\tlat us\tch\tts\n");
+
+    t0 = now();
+    while((n = fread(buf, sizeof(float), CHUNK, f)) > 0) {
+        ldpc_stream_push(s, buf, n);
+        symbols += n;
+    }
+    ldpc_stream_flush(s);
+    elapsed = now() - t0;
+    ldpc_stream_free(s);
+    fclose(f);
+
+    nlat = r.frames < r.max_frames ? r.frames : r.max_frames;
+    qsort(r.latency, nlat, sizeof(double), cmp_double);
+
+    printf("Symbols\t\t%llu\n", (unsigned long long)symbols);
+    printf("Frames\t\t%ld\n", r.frames);
+    printf("Decoded\t\t%ld\n", r.decoded);
+    printf("Checksum OK\t%ld\n", r.checksum_ok);
+    printf("Out of order\t%ld\n", r.out_of_order);
+    printf("Threads\t\t%d\n", threads);
+    printf("Elapsed\t\t%.3f s\n", elapsed);
+    printf("Throughput\t%.3g symbols/s, %.0fx real time at %g baud\n",
+           symbols / elapsed, symbols / elapsed / baud, baud);
+    if(nlat > 0)
+        printf("Latency\t\tmedian %.1f us, 99%% %.1f us, max %.1f us\n",
+               r.latency[nlat/2] * 1e6, r.latency[(nlat*99)/100] * 1e6,
+               r.latency[nlat-1] * 1e6);
+
+    free(r.latency);
+    free(buf);
+    return 0;
+}
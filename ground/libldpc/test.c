@@ -261,17 +261,31 @@ static double llrs[256] = {
 
 
 int main() {
-    int i, j;
+    int i, j, mode;
     bool result;
     uint8_t msg[16];
-    for(i=0; i<16; i++)
-        msg[i] = 0xFF;
+    const char* mode_names[] = {"flooding SPA", "layered NMS", "layered OMS",
+                                "fixed-point NMS"};
+    if(parity_code_edges(&parity_code_256_128) != E) {
+        printf("Code has %d edges, expected E = %d\n",
+               parity_code_edges(&parity_code_256_128), E);
+        return 1;
+    }
     ldpc_init();
-    for(i=0; i<100; i++) {
-        result = ldpc_decode(llrs, msg);
-        for(j=0; j<16; j++)
-            printf("%d ", msg[j]);
-        printf("\n");
+    for(mode=LDPC_MODE_FLOODING_SPA; mode<=LDPC_MODE_LAYERED_NMS_FIXED; mode++) {
+        ldpc_set_mode((ldpc_mode)mode);
+        printf("%s:\n", mode_names[mode]);
+        for(i=0; i<16; i++)
+            msg[i] = 0xFF;
+        for(i=0; i<100; i++) {
+            result = ldpc_decode(llrs, msg);
+            if(i % 25 != 0)
+                continue;
+            printf("%d: ", result);
+            for(j=0; j<16; j++)
+                printf("%d ", msg[j]);
+            printf("\n");
+        }
     }
     return 0;
 }
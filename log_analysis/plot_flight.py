@@ -1,9 +1,13 @@
+import os
 import sys
 import math
-import struct
 import numpy as np
 import matplotlib.pyplot as plt
 
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                                "..", "m2telem"))
+import m2telem
+
 if len(sys.argv) != 2:
     print("Usage: {} <binary logfile>".format(sys.argv[0]))
     sys.exit()
@@ -51,83 +55,43 @@ def p2a_nzl(p, b):
     tb = Tb[b]
     return hb + tb/lb * (math.pow(p/pb, (-Rs*lb)/(g0*M)) - 1)
 
-se_t = []
-se_dt = []
-se_h = []
-se_v = []
-se_a = []
-baro_t = []
-baro_h = []
-accel_t = []
-accel_a = []
-mission_t = []
-mission_s = []
-lga_y = []
-hga_y = []
+log = m2telem.load(sys.argv[1])
+empty = m2telem.Channel(np.zeros(0), np.zeros((0, 4)), np.zeros(0))
+
+def channel(name):
+    return log.get(name, empty)
+
+def seconds(ch):
+    return ch.t / m2telem.TICKS_PER_SECOND
+
+for axis, grav, _, _ in channel("CAL_LG_ACCEL").value:
+    print("LGA cal axis={} grav={}".format(axis, grav))
+for axis, grav, _, _ in channel("CAL_HG_ACCEL").value:
+    print("HGA cal axis={} grav={}".format(axis, grav))
+
+se_t = seconds(channel("SE_T_H"))
+se_h = channel("SE_T_H").value[:, 1]
+se_v = channel("SE_V_A").value[:, 0]
+se_a = channel("SE_V_A").value[:, 1]
+baro_t = seconds(channel("SE_PRESSURE"))
+baro_h = [p2a(p) for p in channel("SE_PRESSURE").value[:, 0]]
+accel_t = seconds(channel("SE_ACCEL"))
+accel_a = channel("SE_ACCEL").value[:, 0]
+mission_t = seconds(channel("STATE_MISSION"))
+mission_s = channel("STATE_MISSION").value[:, 1]
+lga_y = channel("IMU_LG_ACCEL").value[:, 1]
+hga_y = channel("IMU_HG_ACCEL").value[:, 1]
 pyro_fire_t = []
 pyro_fire_c = []
-last_timestamp = 0
-t_correction = 0
-
-with open(sys.argv[1], "rb") as f:
-    while True:
-        try:
-            packet = f.read(16)
-        except ValueError:
-            break
-        if len(packet) != 16:
-            break
-        
-        timestamp = struct.unpack("I", packet[8:12])[0]
-        mode, channel, _, _ = struct.unpack("BBBB", packet[12:])
-        if timestamp < last_timestamp:
-            t_correction += 0xFFFFFFFF
-        last_timestamp = timestamp
-        timestamp += t_correction
-
-        if channel == 0x11:
-            data = struct.unpack("hhhh", packet[:8])
-            axis, grav, _, _ = data
-            print("LGA cal axis={} grav={}".format(axis, grav))
-        if channel == 0x12:
-            data = struct.unpack("hhhh", packet[:8])
-            axis, grav, _, _ = data
-            print("HGA cal axis={} grav={}".format(axis, grav))
-        if channel == 0x50:
-            data = struct.unpack("ff", packet[:8])
-            se_t.append(timestamp / 168E6)
-            se_h.append(data[1])
-        if channel == 0x51:
-            data = struct.unpack("ff", packet[:8])
-            se_v.append(data[0])
-            se_a.append(data[1])
-        if channel == 0x52:
-            data = struct.unpack("ff", packet[:8])
-            baro_t.append(timestamp / 168E6)
-            baro_h.append(p2a(data[0]))
-        if channel == 0x53:
-            data = struct.unpack("ff", packet[:8])
-            accel_t.append(timestamp / 168E6)
-            accel_a.append(data[0])
-        if channel == 0x40:
-            data = struct.unpack("ii", packet[:8])
-            mission_t.append(timestamp / 168E6)
-            mission_s.append(data[1])
-        if channel == 0x20:
-            x, y, z, _ = struct.unpack("hhhh", packet[:8])
-            lga_y.append(y)
-        if channel == 0x21:
-            x, y, z, _ = struct.unpack("hhhh", packet[:8])
-            hga_y.append(y)
-        if channel == 0x61:
-            ch1, ch2, ch3, _ = struct.unpack("hhhh", packet[:8])
-            pyro_fire_t.append(timestamp / 168E6)
-            if ch1:
-                pyro_fire_c.append(1)
-            elif ch2:
-                pyro_fire_c.append(2)
-            elif ch3:
-                pyro_fire_c.append(3)
+for t, (ch1, ch2, ch3, _) in zip(seconds(channel("PYRO_FIRE")),
+                                 channel("PYRO_FIRE").value):
+    pyro_fire_t.append(t)
+    if ch1:
+        pyro_fire_c.append(1)
+    elif ch2:
+        pyro_fire_c.append(2)
+    elif ch3:
+        pyro_fire_c.append(3)
 
 #plt.subplot(2, 1, 1)
 #plt.plot(lga_y)
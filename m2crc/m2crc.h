@@ -0,0 +1,59 @@
+/*
+ * M2CRC
+ * Table driven CRC-16-CCITT shared by m2telem, m2serial and sbp.
+ *
+ * Cambridge University Spaceflight
+ */
+
+#ifndef M2CRC_H
+#define M2CRC_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+/* CRC-16-CCITT ===============================================================
+ *
+ * Polynomial 0x1021, processed MSb first with no reflection. Users differ
+ * only in the initial register value and the final XOR:
+ *   m2telem packets:  init 0x0000, xorout 0x0000 (XMODEM)
+ *   m2serial frames:  init 0xFFFF, xorout 0xFFFF (X.25 without reflection)
+ *   sbp messages:     caller's init, xorout 0x0000
+ *
+ * Bytes are read one at a time, so results do not depend on the machine's
+ * byte order or on buffer alignment.
+ *
+ * M2CRC_SLICES picks slicing-by-8 (4KB of tables, the default) or
+ * slicing-by-4 (2KB) for targets short on flash.
+ */
+#ifndef M2CRC_SLICES
+#define M2CRC_SLICES 8
+#endif
+
+#if M2CRC_SLICES != 4 && M2CRC_SLICES != 8
+#error "M2CRC_SLICES must be 4 or 8"
+#endif
+
+/*
+ * Incremental API: start a register with `init`, feed it any number of
+ * buffers with m2crc_ccitt_update, then finish with `crc ^ xorout`.
+ */
+uint16_t m2crc_ccitt_update(uint16_t crc, const void *buf, size_t len);
+
+/* The whole CRC of one buffer. */
+uint16_t m2crc_ccitt(const void *buf, size_t len,
+                     uint16_t init, uint16_t xorout);
+
+/*
+ * Batch API: CRC `n` records of `len` bytes each, starting `stride` bytes
+ * apart in `buf`, writing one CRC per record to `crcs`. For example the
+ * checksums of an array of TelemPackets are
+ * m2crc_ccitt_batch(pkts, 16, 14, n, 0x0000, 0x0000, crcs).
+ */
+void m2crc_ccitt_batch(const void *buf, size_t stride, size_t len, size_t n,
+                       uint16_t init, uint16_t xorout, uint16_t *crcs);
+
+/* Plain bit at a time CRC, for testing and benchmarks. */
+uint16_t m2crc_ccitt_bitwise(const void *buf, size_t len,
+                             uint16_t init, uint16_t xorout);
+
+#endif /* M2CRC_H */
@@ -0,0 +1,159 @@
+/*
+ * Check the table driven CRCs against the bitwise reference and time them.
+ *
+ * Checks every length up to 64 bytes at every alignment for the init and
+ * xorout of each user, in one go and split at every point, and the batch
+ * call over TelemPacket shaped records. Then reports packets/s for the
+ * 14 byte telemetry header, one at a time and batched, and MB/s on a
+ * large buffer.
+ *
+ * Usage: m2crc_bench [packets]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include "m2crc.h"
+
+static uint64_t xorshift_state = 0x2545F4914F6CDD1DULL;
+
+static uint64_t xorshift64s(void)
+{
+    xorshift_state ^= xorshift_state >> 12;
+    xorshift_state ^= xorshift_state << 25;
+    xorshift_state ^= xorshift_state >> 27;
+    return xorshift_state * 0x2545F4914F6CDD1DULL;
+}
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static const uint16_t params[3][2] = {
+    {0x0000, 0x0000}, {0xFFFF, 0xFFFF}, {0x1D0F, 0x0000}
+};
+
+static int check(void)
+{
+    uint8_t buf[64 + 8], recs[16 * 64];
+    uint16_t crcs[64];
+    size_t len, off, split, i;
+    int p, bad = 0;
+
+    for(i=0; i<sizeof(buf); i++) {
+        buf[i] = xorshift64s();
+    }
+    for(i=0; i<sizeof(recs); i++) {
+        recs[i] = xorshift64s();
+    }
+
+    for(p=0; p<3; p++) {
+        uint16_t init = params[p][0], xorout = params[p][1];
+        for(off=0; off<8; off++) {
+            for(len=0; len<=64; len++) {
+                const uint8_t* b = buf + off;
+                uint16_t ref = m2crc_ccitt_bitwise(b, len, init, xorout);
+                bad += m2crc_ccitt(b, len, init, xorout) != ref;
+                for(split=0; split<=len; split++) {
+                    uint16_t crc = m2crc_ccitt_update(init, b, split);
+                    crc = m2crc_ccitt_update(crc, b + split, len - split);
+                    bad += (crc ^ xorout) != ref;
+                }
+            }
+        }
+
+        m2crc_ccitt_batch(recs, 16, 14, 64, init, xorout, crcs);
+        for(i=0; i<64; i++) {
+            bad += crcs[i]
+                   != m2crc_ccitt_bitwise(recs + 16*i, 14, init, xorout);
+        }
+    }
+
+    /* The standard check value for XMODEM. */
+    bad += m2crc_ccitt("123456789", 9, 0x0000, 0x0000) != 0x31C3;
+
+    return bad;
+}
+
+int main(int argc, char* argv[])
+{
+    size_t n = 1 << 20, i;
+    uint8_t* pkts;
+    uint16_t* crcs;
+    uint16_t sink = 0;
+    double t0, t;
+    int bad, r, reps = 8;
+
+    if(argc > 1) {
+        n = strtoul(argv[1], NULL, 0);
+    }
+
+    bad = check();
+    printf("Slicing-by-%d: %d mismatches\n", M2CRC_SLICES, bad);
+    if(bad) {
+        return 1;
+    }
+
+    pkts = malloc(16 * n);
+    crcs = malloc(n * sizeof(uint16_t));
+    if(pkts == NULL || crcs == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    for(i=0; i<16*n; i++) {
+        pkts[i] = xorshift64s();
+    }
+    memset(crcs, 0, n * sizeof(uint16_t));
+
+    printf("Kernel\t\t\tpackets/s\tMB/s\n");
+
+    t0 = now();
+    for(i=0; i<n; i++) {
+        crcs[i] = m2crc_ccitt_bitwise(pkts + 16*i, 14, 0x0000, 0x0000);
+    }
+    t = now() - t0;
+    sink ^= crcs[n/2];
+    printf("bitwise\t\t\t%.3g\t\t%.1f\n", n / t, 14.0 * n / t / 1e6);
+
+    t0 = now();
+    for(r=0; r<reps; r++) {
+        for(i=0; i<n; i++) {
+            crcs[i] = m2crc_ccitt(pkts + 16*i, 14, 0x0000, 0x0000);
+        }
+        sink ^= crcs[r];
+    }
+    t = now() - t0;
+    printf("m2crc_ccitt\t\t%.3g\t\t%.1f\n",
+           (double)n * reps / t, 14.0 * n * reps / t / 1e6);
+
+    t0 = now();
+    for(r=0; r<reps; r++) {
+        m2crc_ccitt_batch(pkts, 16, 14, n, 0x0000, 0x0000, crcs);
+        sink ^= crcs[r];
+    }
+    t = now() - t0;
+    printf("m2crc_ccitt_batch\t%.3g\t\t%.1f\n",
+           (double)n * reps / t, 14.0 * n * reps / t / 1e6);
+
+    t0 = now();
+    for(r=0; r<reps; r++) {
+        sink ^= m2crc_ccitt(pkts, 16 * n, 0x0000, 0x0000);
+    }
+    t = now() - t0;
+    printf("m2crc_ccitt, %zuMB\t-\t\t%.1f\n", 16 * n >> 20,
+           16.0 * n * reps / t / 1e6);
+
+    /* Keep the timed loops from being optimised away. */
+    if(sink == 12345) {
+        printf("\n");
+    }
+
+    free(pkts);
+    free(crcs);
+    return 0;
+}
@@ -27,7 +27,8 @@ config_t conf = {
     .pyro_3 = CFG_PYRO_DROGUE, .ignition_accel = 30,
     .burnout_time = 6000, .apogee_time = 60000, .main_altitude = 300,
     .main_time = 30000, .landing_time = 300000,
-    .use_adc = false, .use_magno = false, .use_gyro = false
+    .use_adc = false, .use_magno = false, .use_gyro = false,
+    .log_compressed = false
 };
 
 /* ------------------------------------------------------------------------- */
@@ -102,6 +103,10 @@ bool read_config(SDFILE* file)
         read_bool(file, "use_magno", &conf.use_magno) &&
         read_bool(file, "use_gyro", &conf.use_gyro);
 
+    /* Optional, so config files from before it was added still load. */
+    if (conf.config_loaded)
+        read_bool(file, "log_compressed", &conf.log_compressed);
+
     (void)read_float;
 
     return conf.config_loaded;
@@ -53,6 +53,7 @@ typedef struct config_ {
     unsigned int main_altitude, main_time;
     unsigned int landing_time;
     bool use_adc, use_magno, use_gyro;
+    bool log_compressed;
 } config_t;
 
 /* This is the global configuration that can be accessed from any file.
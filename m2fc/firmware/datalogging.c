@@ -14,6 +14,7 @@
 #include "config.h"
 #include "chprintf.h"
 #include "m2status.h"
+#include "m2telem_clog.h"
 
 /* ------------------------------------------------------------------------- */
 
@@ -21,6 +22,7 @@
 #define LOG_CACHE_SIZE    16384 // 16KB
 
 static void mem_init(void);
+static void write_cache(SDFILE* file, SDFS* file_system);
 static void _log(TelemPacket *packet);
 
 /* ------------------------------------------------------------------------- */
@@ -49,6 +51,12 @@ static volatile msg_t mailbox_buffer[LOG_MEMPOOL_ITEMS]
 
 static uint8_t log_location = 0;
 
+/* With conf.log_compressed, packets are compressed into log_cache one block
+ * at a time rather than copied in, and logs are named log_NNNNN.clg.
+ */
+static ClogEncoder log_clog __attribute__((section(".ccm")));
+static const char* log_ext = "bin";
+
 /* ------------------------------------------------------------------------- */
 /* MAIN THREAD FUNCTIONS */
 /* ------------------------------------------------------------------------- */
@@ -65,15 +73,19 @@ msg_t datalogging_thread(void* arg)
     SDFILE file;             // file struct thing
     msg_t mailbox_res;       // mailbox fetch result
     intptr_t data_msg;       // buffer to store the fetched mailbox item
-    SDRESULT write_res;      // result of writing data to file system
-    SDRESULT open_res;       // result of re-opening the log file
+    TelemPacket packet;      // packet fetched, when compressing
     (void)arg;
 
     /* initialise stuff */
     m2status_datalogging_status(STATUS_WAIT);
     chRegSetThreadName("Datalogging");
     mem_init();
-    while (microsd_open_file_inc(&file, "log", "bin", &file_system) != FR_OK);
+    if(conf.log_compressed) {
+        log_ext = "clg";
+        m2telem_clog_start(&log_clog, (uint8_t*)log_cache, LOG_CACHE_SIZE);
+    }
+    while (microsd_open_file_inc(&file, "log", log_ext, &file_system)
+           != FR_OK);
 
     if(conf.location == CFG_M2FC_NOSE)
         log_c(M2T_CH_SYS_INIT, "M2FCNOSE");
@@ -92,27 +104,30 @@ msg_t datalogging_thread(void* arg)
         /* Mailbox was reset while waiting/fetch failed ... try again! */
         if (mailbox_res != RDY_OK || data_msg == 0) continue;
 
+        if(conf.log_compressed) {
+            memcpy(&packet, (void*)data_msg, packet_size);
+            chPoolFree(&log_mempool, (void*)data_msg);
+
+            /* If the packet doesn't fit in the block, write the block out
+             * and start the next one with it.
+             */
+            if(!m2telem_clog_add(&log_clog, &packet)) {
+                m2telem_clog_finish(&log_clog);
+                write_cache(&file, &file_system);
+                m2telem_clog_start(&log_clog, (uint8_t*)log_cache,
+                                   LOG_CACHE_SIZE);
+                m2telem_clog_add(&log_clog, &packet);
+            }
+            continue;
+        }
+
         /* Put packet in the static cache and free it from the memory pool */
         memcpy((void*)cache_ptr, (void*)data_msg, packet_size);
         chPoolFree(&log_mempool, (void*)data_msg);
 
         /* If the cache is full, write it all to the sd card */
         if(cache_ptr + packet_size >= log_cache + LOG_CACHE_SIZE) {
-            write_res = microsd_write(&file, (char*)log_cache, LOG_CACHE_SIZE);
-
-            /* If the write failed, keep attempting to re-open the log file
-             * and write the data out when we succeed.
-             */
-            while (write_res != FR_OK) {
-                m2status_datalogging_status(STATUS_ERR_WRITING);
-                microsd_close_file(&file);
-                open_res = microsd_open_file_inc(&file, "log", "bin",
-                                                 &file_system);
-                if(open_res == FR_OK) {
-                    write_res = microsd_write(&file, (char*)log_cache,
-                                              LOG_CACHE_SIZE);
-                }
-            }
+            write_cache(&file, &file_system);
 
             /* reset cache pointer to beginning of cache */
             cache_ptr = log_cache;
@@ -122,6 +137,27 @@ msg_t datalogging_thread(void* arg)
     }
 }
 
+/* Write the whole cache to the log file. If the write fails, keep attempting
+ * to re-open the log file and write the data out when we succeed.
+ */
+static void write_cache(SDFILE* file, SDFS* file_system)
+{
+    SDRESULT write_res;      // result of writing data to file system
+    SDRESULT open_res;       // result of re-opening the log file
+
+    write_res = microsd_write(file, (char*)log_cache, LOG_CACHE_SIZE);
+
+    while (write_res != FR_OK) {
+        m2status_datalogging_status(STATUS_ERR_WRITING);
+        microsd_close_file(file);
+        open_res = microsd_open_file_inc(file, "log", log_ext, file_system);
+        if(open_res == FR_OK) {
+            write_res = microsd_write(file, (char*)log_cache,
+                                      LOG_CACHE_SIZE);
+        }
+    }
+}
+
 /* Initialise memory management structures used to keep the data temporarily
  * in memory.
  */
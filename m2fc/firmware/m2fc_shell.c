@@ -15,6 +15,8 @@
 #include "pyro.h"
 #include "config.h"
 #include "m2status.h"
+#include "m2telem.h"
+#include "m2crc.h"
 
 static void cmd_mem(BaseSequentialStream *chp, int argc, char *argv[]) {
   size_t n, size;
@@ -132,6 +134,40 @@ static void cmd_config(BaseSequentialStream *chp, int argc, char* argv[]) {
 
 }
 
+static void cmd_crc(BaseSequentialStream *chp, int argc, char* argv[]) {
+    (void)argv;
+    if(argc > 0) {
+        chprintf(chp, "Usage: crc\r\n");
+        chprintf(chp, "Times the telemetry packet checksums in CPU cycles\r\n");
+        return;
+    }
+
+    static TelemPacket pkts[32];
+    static uint16_t crcs[32];
+    halrtcnt_t t0, t1, t2, t3;
+    uint16_t ref;
+    int i;
+
+    for(i=0; i<(int)sizeof(pkts); i++) {
+        ((uint8_t*)pkts)[i] = i * 37 + 11;
+    }
+
+    t0 = halGetCounterValue();
+    ref = m2crc_ccitt_bitwise(&pkts[0], 14, 0x0000, 0x0000);
+    t1 = halGetCounterValue();
+    crcs[0] = m2crc_ccitt(&pkts[0], 14, 0x0000, 0x0000);
+    t2 = halGetCounterValue();
+    m2crc_ccitt_batch(pkts, sizeof(TelemPacket), 14, 32, 0x0000, 0x0000,
+                      crcs);
+    t3 = halGetCounterValue();
+
+    chprintf(chp, "bitwise: %u cycles/packet\r\n", t1 - t0);
+    chprintf(chp, "slicing-by-%d: %u cycles/packet\r\n", M2CRC_SLICES,
+             t2 - t1);
+    chprintf(chp, "batch of 32: %u cycles/packet\r\n", (t3 - t2) / 32);
+    chprintf(chp, "outputs %s\r\n", crcs[0] == ref ? "match" : "DIFFER");
+}
+
 void m2fc_shell_run(BaseSequentialStream* bss)
 {
     static const ShellCommand commands[] = {
@@ -141,6 +177,7 @@ void m2fc_shell_run(BaseSequentialStream* bss)
         {"pyro", cmd_pyro},
         {"config", cmd_config},
         {"status", m2status_shell_cmd},
+        {"crc", cmd_crc},
         {NULL, NULL}
     };
     static ShellConfig shell_cfg;
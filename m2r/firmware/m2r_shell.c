@@ -7,7 +7,10 @@
 #include <hal.h>
 #include "chprintf.h"
 #include <stdio.h>
+#include <string.h>
 #include "m2status.h"
+#include "ldpc_encoder.h"
+#include "hamming_ecc.h"
 
 static void cmd_mem(BaseSequentialStream *chp, int argc, char *argv[]) {
   size_t n, size;
@@ -74,6 +77,81 @@ static void cmd_version(BaseSequentialStream *chp, int argc, char* argv[]) {
     chprintf(chp, "Version: " M2R_FIRMWARE_VERSION "\r\n");
 }
 
+static void cmd_ldpcenc(BaseSequentialStream *chp, int argc, char* argv[]) {
+    (void)argv;
+    if(argc > 0) {
+        chprintf(chp, "Usage: ldpcenc\r\n");
+        chprintf(chp, "Times the LDPC encoders in CPU cycles\r\n");
+        return;
+    }
+
+    static uint8_t data[16], coded_ref[32], coded[32 * 8];
+    halrtcnt_t t0, t1, t2, t3;
+    int i;
+
+    for(i=0; i<16; i++) {
+        data[i] = i * 37 + 11;
+    }
+
+    t0 = halGetCounterValue();
+    ldpc_encode_bitwise(data, coded_ref);
+    t1 = halGetCounterValue();
+    ldpc_encode(data, coded);
+    t2 = halGetCounterValue();
+    for(i=0; i<8; i++) {
+        ldpc_encode(data, coded + 32*i);
+    }
+    t3 = halGetCounterValue();
+
+    chprintf(chp, "bitwise encoder: %u cycles\r\n", t1 - t0);
+    chprintf(chp, "quasi-cyclic encoder: %u cycles\r\n", t2 - t1);
+    chprintf(chp, "quasi-cyclic, 8 frames: %u cycles/frame\r\n",
+             (t3 - t2) / 8);
+    chprintf(chp, "outputs %s\r\n",
+             memcmp(coded, coded_ref, 32) == 0 ? "match" : "DIFFER");
+}
+
+static void cmd_hamming(BaseSequentialStream *chp, int argc, char* argv[]) {
+    (void)argv;
+    if(argc > 0) {
+        chprintf(chp, "Usage: hamming\r\n");
+        chprintf(chp, "Times the Hamming interleavers in CPU cycles\r\n");
+        return;
+    }
+
+    static uint8_t coded[32 * 8], il_ref[28], il[28 * 8], out[32 * 8];
+    halrtcnt_t t0, t1, t2, t3, t4, t5, t6;
+    int i;
+
+    for(i=0; i<32*8; i++) {
+        coded[i] = (i * 37 + 11) & 0x7F;
+    }
+
+    t0 = halGetCounterValue();
+    coded_to_interleaved_bitwise(coded, il_ref);
+    t1 = halGetCounterValue();
+    coded_to_interleaved(coded, il);
+    t2 = halGetCounterValue();
+    coded_to_interleaved_batch(coded, il, 8);
+    t3 = halGetCounterValue();
+    interleaved_to_coded_bitwise(il_ref, out);
+    t4 = halGetCounterValue();
+    interleaved_to_coded(il, out);
+    t5 = halGetCounterValue();
+    interleaved_to_coded_batch(il, out, 8);
+    t6 = halGetCounterValue();
+
+    chprintf(chp, "bitwise interleave: %u cycles\r\n", t1 - t0);
+    chprintf(chp, "transpose interleave: %u cycles\r\n", t2 - t1);
+    chprintf(chp, "transpose, 8 blocks: %u cycles/block\r\n", (t3 - t2) / 8);
+    chprintf(chp, "bitwise deinterleave: %u cycles\r\n", t4 - t3);
+    chprintf(chp, "transpose deinterleave: %u cycles\r\n", t5 - t4);
+    chprintf(chp, "transpose, 8 blocks: %u cycles/block\r\n", (t6 - t5) / 8);
+    chprintf(chp, "outputs %s\r\n",
+             memcmp(il, il_ref, 28) == 0 && memcmp(out, coded, 32) == 0
+             ? "match" : "DIFFER");
+}
+
 struct SemihostingVMT {
     _base_sequential_stream_methods
 };
@@ -119,6 +197,8 @@ void m2r_shell_run(BaseSequentialStream *bss)
         {"rt", cmd_rt},
         {"status", m2status_shell_cmd},
         {"version", cmd_version},
+        {"ldpcenc", cmd_ldpcenc},
+        {"hamming", cmd_hamming},
         {NULL, NULL}
     };
 
@@ -0,0 +1,264 @@
+/* Time the Hamming(7,4) interleaver, deinterleaver and decoders.
+ *
+ * Checks the transpose based coded_to_interleaved and interleaved_to_coded
+ * bit-exact against the original bit at a time loops on random blocks, in
+ * both directions and through the batch calls, then reports blocks per
+ * second for each. Then checks the soft decoders agree with each other and
+ * with the hard decoder on noiseless LLRs, and reports codewords per second
+ * for all three.
+ *
+ * Usage: hamming_bench [blocks]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include "hamming_ecc.h"
+
+static uint64_t xorshift_state = 0x2545F4914F6CDD1DULL;
+
+static uint64_t xorshift64s(void)
+{
+    xorshift_state ^= xorshift_state >> 12;
+    xorshift_state ^= xorshift_state << 25;
+    xorshift_state ^= xorshift_state >> 27;
+    return xorshift_state * 0x2545F4914F6CDD1DULL;
+}
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Returns the number of mismatching blocks out of `n`. */
+static size_t check(const uint8_t* coded, const uint8_t* interleaved,
+                    size_t n)
+{
+    uint8_t il_ref[28], il[28], c_ref[32], c[32];
+    uint8_t* il_batch = malloc(28 * n);
+    uint8_t* c_batch = malloc(32 * n);
+    size_t i, bad = 0;
+
+    coded_to_interleaved_batch(coded, il_batch, n);
+    interleaved_to_coded_batch(interleaved, c_batch, n);
+
+    for(i=0; i<n; i++) {
+        uint8_t in_c[32], in_il[28];
+        memcpy(in_c, coded + 32*i, 32);
+        memcpy(in_il, interleaved + 28*i, 28);
+
+        coded_to_interleaved_bitwise(in_c, il_ref);
+        coded_to_interleaved(in_c, il);
+        interleaved_to_coded_bitwise(in_il, c_ref);
+        interleaved_to_coded(in_il, c);
+
+        bad += memcmp(il, il_ref, 28) != 0
+            || memcmp(il_batch + 28*i, il_ref, 28) != 0
+            || memcmp(c, c_ref, 32) != 0
+            || memcmp(c_batch + 32*i, c_ref, 32) != 0;
+    }
+
+    free(il_batch);
+    free(c_batch);
+    return bad;
+}
+
+/* Returns the number of blocks out of `n` where the soft decoders disagree
+ * with each other, or with the sent data on noiseless LLRs.
+ */
+static size_t check_soft(const float* llrs, const uint8_t* coded, size_t n)
+{
+    uint8_t* data = malloc(16 * n);
+    uint8_t* nibbles = malloc(32 * n);
+    float* per_codeword = malloc(224 * n * sizeof(float));
+    float clean[224];
+    uint8_t il[28], c[32], ref[16], out[16];
+    size_t b, bad = 0;
+    int i, j;
+
+    /* Reorder to 7 LLRs per codeword for hamming_soft_decode. */
+    for(b=0; b<n; b++) {
+        for(i=0; i<7; i++) {
+            for(j=0; j<32; j++) {
+                per_codeword[224*b + 7*j + i] = llrs[224*b + 32*i + j];
+            }
+        }
+    }
+    hamming_soft_decode_blocks(llrs, data, n);
+    hamming_soft_decode(per_codeword, nibbles, 32 * n);
+
+    for(b=0; b<n; b++) {
+        for(i=0; i<16; i++) {
+            bad += data[16*b + i] != ((nibbles[32*b + 2*i] << 4)
+                                      | nibbles[32*b + 2*i + 1]);
+        }
+
+        memcpy(c, coded + 32*b, 32);
+        coded_to_data(c, ref);
+        coded_to_interleaved(c, il);
+        for(i=0; i<224; i++) {
+            clean[i] = (il[i/8] >> (i%8)) & 1 ? -1.0f : 1.0f;
+        }
+        hamming_soft_decode_blocks(clean, out, 1);
+        bad += memcmp(out, ref, 16) != 0;
+    }
+
+    free(data);
+    free(nibbles);
+    free(per_codeword);
+    return bad;
+}
+
+int main(int argc, char* argv[])
+{
+    size_t n = 1 << 16, i, bad;
+    int reps = 64, r;
+    uint8_t *coded, *interleaved, *out, *data;
+    float *llrs;
+    double t0, t;
+    unsigned sink = 0;
+
+    if(argc > 1) {
+        n = strtoul(argv[1], NULL, 0);
+    }
+
+    coded = malloc(32 * n);
+    interleaved = malloc(28 * n);
+    out = malloc(32 * n);
+    data = malloc(16 * n);
+    llrs = malloc(224 * n * sizeof(float));
+    if(coded == NULL || interleaved == NULL || out == NULL || data == NULL
+       || llrs == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+
+    /* Coded bytes always have their MSb clear, interleaved ones need not. */
+    for(i=0; i<32*n; i++) {
+        coded[i] = xorshift64s() & 0x7F;
+    }
+    for(i=0; i<28*n; i++) {
+        interleaved[i] = xorshift64s() & 0xFF;
+    }
+
+    /* Soft decoder input needs only be LLR shaped, not from real codewords:
+     * every candidate is scored either way.
+     */
+    for(i=0; i<224*n; i++) {
+        llrs[i] = (float)(xorshift64s() >> 40) / (1 << 22) - 2.0f;
+    }
+
+    bad = check(coded, interleaved, n);
+    printf("Checked %zu blocks: %zu mismatches\n", n, bad);
+    if(bad) {
+        return 1;
+    }
+
+    bad = check_soft(llrs, coded, n);
+    printf("Checked soft decoders on %zu blocks: %zu mismatches\n", n, bad);
+    if(bad) {
+        return 1;
+    }
+
+    printf("\nKernel\t\t\t\tblocks/s\n");
+
+    t0 = now();
+    for(r=0; r<reps/8; r++) {
+        for(i=0; i<n; i++) {
+            coded_to_interleaved_bitwise(coded + 32*i, out + 28*i);
+        }
+        sink += out[r];
+    }
+    t = now() - t0;
+    printf("coded_to_interleaved_bitwise\t%.3g\n", (double)n * (reps/8) / t);
+
+    t0 = now();
+    for(r=0; r<reps; r++) {
+        for(i=0; i<n; i++) {
+            coded_to_interleaved(coded + 32*i, out + 28*i);
+        }
+        sink += out[r];
+    }
+    t = now() - t0;
+    printf("coded_to_interleaved\t\t%.3g\n", (double)n * reps / t);
+
+    t0 = now();
+    for(r=0; r<reps; r++) {
+        coded_to_interleaved_batch(coded, out, n);
+        sink += out[r];
+    }
+    t = now() - t0;
+    printf("coded_to_interleaved_batch\t%.3g\n", (double)n * reps / t);
+
+    t0 = now();
+    for(r=0; r<reps/8; r++) {
+        for(i=0; i<n; i++) {
+            interleaved_to_coded_bitwise(interleaved + 28*i, out + 32*i);
+        }
+        sink += out[r];
+    }
+    t = now() - t0;
+    printf("interleaved_to_coded_bitwise\t%.3g\n", (double)n * (reps/8) / t);
+
+    t0 = now();
+    for(r=0; r<reps; r++) {
+        for(i=0; i<n; i++) {
+            interleaved_to_coded(interleaved + 28*i, out + 32*i);
+        }
+        sink += out[r];
+    }
+    t = now() - t0;
+    printf("interleaved_to_coded\t\t%.3g\n", (double)n * reps / t);
+
+    t0 = now();
+    for(r=0; r<reps; r++) {
+        interleaved_to_coded_batch(interleaved, out, n);
+        sink += out[r];
+    }
+    t = now() - t0;
+    printf("interleaved_to_coded_batch\t%.3g\n", (double)n * reps / t);
+
+    printf("\nDecoder\t\t\t\tcodewords/s\n");
+
+    t0 = now();
+    for(r=0; r<reps; r++) {
+        for(i=0; i<n; i++) {
+            coded_to_data(coded + 32*i, data + 16*i);
+        }
+        sink += data[r];
+    }
+    t = now() - t0;
+    printf("coded_to_data (hard)\t\t%.3g\n", 32.0 * n * reps / t);
+
+    t0 = now();
+    for(r=0; r<reps/8; r++) {
+        hamming_soft_decode(llrs, out, 32 * n);
+        sink += out[r];
+    }
+    t = now() - t0;
+    printf("hamming_soft_decode\t\t%.3g\n", 32.0 * n * (reps/8) / t);
+
+    t0 = now();
+    for(r=0; r<reps/8; r++) {
+        hamming_soft_decode_blocks(llrs, data, n);
+        sink += data[r];
+    }
+    t = now() - t0;
+    printf("hamming_soft_decode_blocks\t%.3g\n", 32.0 * n * (reps/8) / t);
+
+    /* Keep the timed loops from being optimised away. */
+    if(sink == 12345) {
+        printf("\n");
+    }
+
+    free(coded);
+    free(interleaved);
+    free(out);
+    free(data);
+    free(llrs);
+    return 0;
+}
@@ -1,5 +1,15 @@
 #include "hamming_ecc.h"
 
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+/* Eight lanes, which GCC maps to whatever SIMD registers the target has. */
+typedef float v8f __attribute__((vector_size(32)));
+typedef int32_t v8i __attribute__((vector_size(32)));
+
 static const uint8_t hamming_7_4_codewords[16] = {
     0x00, 0x0b, 0x17, 0x1c, 0x26, 0x2d, 0x31, 0x3a,
     0x45, 0x4e, 0x52, 0x59, 0x63, 0x68, 0x74, 0x7f
@@ -52,18 +62,235 @@ void coded_to_data(uint8_t* coded, uint8_t* data) {
     }
 }
 
+/*
+ * Load and store 8 bytes as a uint64_t with byte k in bits 8k to 8k+7,
+ * whatever the machine's byte order. Compilers turn these into plain
+ * loads and stores on little-endian targets.
+ */
+static inline uint64_t load_le64(const uint8_t* p)
+{
+    return  (uint64_t)p[0]        | ((uint64_t)p[1] << 8)
+         | ((uint64_t)p[2] << 16) | ((uint64_t)p[3] << 24)
+         | ((uint64_t)p[4] << 32) | ((uint64_t)p[5] << 40)
+         | ((uint64_t)p[6] << 48) | ((uint64_t)p[7] << 56);
+}
+
+/*
+ * Transpose the 8x8 bit matrix in `x`, where bit c of byte r is element
+ * (r, c), in three rounds of swapping 1x1, 2x2 and then 4x4 sub-blocks.
+ * Hacker's Delight, 2nd ed., section 7-3.
+ */
+static inline uint64_t transpose8(uint64_t x)
+{
+    uint64_t t;
+    t = (x ^ (x >> 7))  & 0x00AA00AA00AA00AAULL;
+    x = x ^ t ^ (t << 7);
+    t = (x ^ (x >> 14)) & 0x0000CCCC0000CCCCULL;
+    x = x ^ t ^ (t << 14);
+    t = (x ^ (x >> 28)) & 0x00000000F0F0F0F0ULL;
+    x = x ^ t ^ (t << 28);
+    return x;
+}
+
+/*
+ * Each group of 8 coded bytes is one 8x8 bit matrix, and its transpose
+ * holds bit i of all 8 bytes in byte i, which is interleaved byte 4i + b
+ * for group b. Byte 7 of the transpose is the always-zero MSbs.
+ */
+static inline void coded_to_interleaved_swar(const uint8_t* coded,
+                                             uint8_t* interleaved)
+{
+    int b, i;
+    for(b=0; b<4; b++) {
+        uint64_t x = transpose8(load_le64(&coded[8*b]));
+        for(i=0; i<7; i++) {
+            interleaved[4*i + b] = x >> (8*i);
+        }
+    }
+}
+
+#if defined(__SSE2__)
+/*
+ * On x86, movemask collects the MSb of every byte of a vector at once, so
+ * shifting each byte left by one in turn brings out bits 6 down to 0 of all
+ * 32 coded bytes as the 32 bit interleaved words.
+ */
+static inline void store_le32(uint8_t* p, uint32_t x)
+{
+    p[0] = x;
+    p[1] = x >> 8;
+    p[2] = x >> 16;
+    p[3] = x >> 24;
+}
+
+#if defined(__AVX2__)
+static inline void coded_to_interleaved_simd(const uint8_t* coded,
+                                             uint8_t* interleaved)
+{
+    __m256i v = _mm256_loadu_si256((const __m256i*)coded);
+    int i;
+    for(i=6; i>=0; i--) {
+        v = _mm256_add_epi8(v, v);
+        store_le32(&interleaved[4*i], (uint32_t)_mm256_movemask_epi8(v));
+    }
+}
+#else
+static inline void coded_to_interleaved_simd(const uint8_t* coded,
+                                             uint8_t* interleaved)
+{
+    __m128i lo = _mm_loadu_si128((const __m128i*)coded);
+    __m128i hi = _mm_loadu_si128((const __m128i*)(coded + 16));
+    int i;
+    for(i=6; i>=0; i--) {
+        lo = _mm_add_epi8(lo, lo);
+        hi = _mm_add_epi8(hi, hi);
+        store_le32(&interleaved[4*i],
+                   (uint32_t)_mm_movemask_epi8(lo)
+                   | ((uint32_t)_mm_movemask_epi8(hi) << 16));
+    }
+}
+#endif
+#endif
+
+/*
+ * The transpose is its own inverse, so gather interleaved bytes 4i + b back
+ * into a matrix, with a zero row for the MSbs, and transpose it again.
+ */
+static inline void interleaved_to_coded_swar(const uint8_t* interleaved,
+                                             uint8_t* coded)
+{
+    int b, i, k;
+    for(b=0; b<4; b++) {
+        uint64_t x = 0;
+        for(i=0; i<7; i++) {
+            x |= (uint64_t)interleaved[4*i + b] << (8*i);
+        }
+        x = transpose8(x);
+        for(k=0; k<8; k++) {
+            coded[8*b + k] = x >> (8*k);
+        }
+    }
+}
+
 /*
  * Interleave 32 bytes (all with MSb=0, i.e. 7bit) from `coded` into
  * 28 bytes in `interleaved`.
- * The first 4 bytes in `interleaved` contain bit 0 of each byte in `coded`,
- * with the very first byte in `interleaved` containing bit 0 (LSb) of the
- * first eight bytes from `coded`.
- * The next 4 bytes in `interleaved` contain bit 1 from each byte in `coded`,
- * again with the 5th byte containing bits from the first eight bytes in
- * `coded`, the 6th byte containing bits from the next eight bytes, etc.
- * NOTE: Endienness-sensitive, requires LE.
+ * See hamming_ecc.h for the layout.
  */
 void coded_to_interleaved(uint8_t* coded, uint8_t* interleaved) {
+#if defined(__SSE2__)
+    coded_to_interleaved_simd(coded, interleaved);
+#else
+    coded_to_interleaved_swar(coded, interleaved);
+#endif
+}
+
+/*
+ * Deinterleaves 28 bytes from `interleaved` into 32 bytes in `coded`.
+ * See coded_to_interleaved for description.
+ */
+void interleaved_to_coded(uint8_t* interleaved, uint8_t* coded) {
+    interleaved_to_coded_swar(interleaved, coded);
+}
+
+void coded_to_interleaved_batch(const uint8_t* coded, uint8_t* interleaved,
+                                size_t n) {
+    size_t i;
+    for(i=0; i<n; i++) {
+#if defined(__SSE2__)
+        coded_to_interleaved_simd(coded + 32*i, interleaved + 28*i);
+#else
+        coded_to_interleaved_swar(coded + 32*i, interleaved + 28*i);
+#endif
+    }
+}
+
+void interleaved_to_coded_batch(const uint8_t* interleaved, uint8_t* coded,
+                                size_t n) {
+    size_t i;
+    for(i=0; i<n; i++) {
+        interleaved_to_coded_swar(interleaved + 28*i, coded + 32*i);
+    }
+}
+
+/*
+ * Soft decode eight codewords at once, one per lane, with `l[i]` holding
+ * the LLRs for bit i. Each candidate's cost is the sum of the LLRs where it
+ * has a 1, and on a tie the lower data nibble is kept.
+ */
+static inline void soft_decode8(const v8f l[7], v8i* nibble)
+{
+    v8f best = {0}, cost;
+    v8i lt;
+    int d, i;
+
+    *nibble = (v8i){0};
+    for(d=1; d<16; d++) {
+        cost = (v8f){0};
+        for(i=0; i<7; i++) {
+            if(hamming_7_4_codewords[d] & (1<<i)) {
+                cost += l[i];
+            }
+        }
+        /* Comparisons give all ones in lanes where true, to select with. */
+        lt = cost < best;
+        best = (v8f)(((v8i)cost & lt) | ((v8i)best & ~lt));
+        *nibble = (lt & d) | (*nibble & ~lt);
+    }
+}
+
+void hamming_soft_decode(const float* llrs, uint8_t* nibbles, size_t n) {
+    float t[7][8];
+    v8f l[7];
+    v8i nibble;
+    size_t j, k, m;
+    int i;
+
+    for(j=0; j<n; j+=8) {
+        /* Transpose to one vector per bit, padding the tail with zeros. */
+        m = n - j < 8 ? n - j : 8;
+        memset(t, 0, sizeof(t));
+        for(k=0; k<m; k++) {
+            for(i=0; i<7; i++) {
+                t[i][k] = llrs[7*(j + k) + i];
+            }
+        }
+        memcpy(l, t, sizeof(l));
+
+        soft_decode8(l, &nibble);
+        for(k=0; k<m; k++) {
+            nibbles[j + k] = nibble[k];
+        }
+    }
+}
+
+void hamming_soft_decode_blocks(const float* llrs, uint8_t* data, size_t n) {
+    v8f l[7];
+    v8i nibble;
+    size_t b;
+    int g, i, k;
+
+    for(b=0; b<n; b++, llrs+=224, data+=16) {
+        /* The interleaved order already puts eight codewords' LLRs for each
+         * bit side by side, so load them straight into the lanes.
+         */
+        for(g=0; g<4; g++) {
+            for(i=0; i<7; i++) {
+                memcpy(&l[i], &llrs[32*i + 8*g], sizeof(v8f));
+            }
+            soft_decode8(l, &nibble);
+            for(k=0; k<4; k++) {
+                data[4*g + k] = (nibble[2*k] << 4) | nibble[2*k + 1];
+            }
+        }
+    }
+}
+
+/*
+ * The original bit at a time loops, kept for testing and benchmarks.
+ * NOTE: Endienness-sensitive, requires LE.
+ */
+void coded_to_interleaved_bitwise(uint8_t* coded, uint8_t* interleaved) {
     int i, j;
     uint32_t* il = (uint32_t*)interleaved;
     for(i=0; i<7; i++) {
@@ -74,11 +301,7 @@ void coded_to_interleaved(uint8_t* coded, uint8_t* interleaved) {
     }
 }
 
-/*
- * Deinterleaves 28 bytes from `interleaved` into 32 bytes in `coded`.
- * See coded_to_interleaved for description.
- */
-void interleaved_to_coded(uint8_t* interleaved, uint8_t* coded) {
+void interleaved_to_coded_bitwise(uint8_t* interleaved, uint8_t* coded) {
     int i, j;
     uint32_t* il = (uint32_t*)interleaved;
     for(i=0; i<32; i++) {
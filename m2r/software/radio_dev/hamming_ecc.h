@@ -1,6 +1,7 @@
 #ifndef HAMMING_ECC_H
 #define HAMMING_ECC_H
 
+#include <stddef.h>
 #include <stdint.h>
 
 /*
@@ -27,7 +28,12 @@ void coded_to_data(uint8_t* coded, uint8_t* data);
  * The next 4 bytes in `interleaved` contain bit 1 from each byte in `coded`,
  * again with the 5th byte containing bits from the first eight bytes in
  * `coded`, the 6th byte containing bits from the next eight bytes, etc.
- * NOTE: Endienness-sensitive, requires LE.
+ * That is, bit k of interleaved[4*i + b] is bit i of coded[8*b + k], which
+ * reads as seven little-endian 32 bit words but is defined bytewise, so the
+ * result is the same on any machine.
+ *
+ * Works by 8x8 bit matrix transposes, as SWAR on 64 bit words or with
+ * SSE2/AVX2 movemask on x86.
  */
 void coded_to_interleaved(uint8_t* coded, uint8_t* interleaved);
 
@@ -37,4 +43,39 @@ void coded_to_interleaved(uint8_t* coded, uint8_t* interleaved);
  */
 void interleaved_to_coded(uint8_t* interleaved, uint8_t* coded);
 
+/*
+ * Interleave `n` consecutive 32 byte blocks from `coded` into `n`
+ * consecutive 28 byte blocks in `interleaved`, and back again.
+ */
+void coded_to_interleaved_batch(const uint8_t* coded, uint8_t* interleaved,
+                                size_t n);
+void interleaved_to_coded_batch(const uint8_t* interleaved, uint8_t* coded,
+                                size_t n);
+
+/*
+ * Maximum likelihood soft decoding from LLRs, positive meaning bit 0 is more
+ * likely, as for the LDPC decoders. Each codeword is scored against all 16
+ * candidates by summing the LLRs of the bits it would have set, and the
+ * lowest sum wins, which for BPSK in AWGN is the nearest codeword.
+ *
+ * hamming_soft_decode takes 7 LLRs per codeword, bits 0 to 6 in order, for
+ * `n` codewords, and writes each one's data nibble to a byte of `nibbles`.
+ */
+void hamming_soft_decode(const float* llrs, uint8_t* nibbles, size_t n);
+
+/*
+ * Decode `n` interleaved blocks of 224 LLRs each into 16 data bytes per
+ * block, as interleaved_to_coded then coded_to_data would from hard bits.
+ * LLRs are in the order of the interleaved bits, so llrs[32*i + j] is for
+ * bit i of coded byte j, which is bit j%8 of interleaved byte 4*i + j/8.
+ */
+void hamming_soft_decode_blocks(const float* llrs, uint8_t* data, size_t n);
+
+/*
+ * Slow bit at a time versions, bit-exact with the above on little-endian
+ * machines only, for testing.
+ */
+void coded_to_interleaved_bitwise(uint8_t* coded, uint8_t* interleaved);
+void interleaved_to_coded_bitwise(uint8_t* interleaved, uint8_t* coded);
+
 #endif /* HAMMING_ECC_H */
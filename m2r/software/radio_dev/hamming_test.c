@@ -3,6 +3,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdbool.h>
+#include <math.h>
 #include "hamming_ecc.h"
 
 bool run_trial(double ber, unsigned int n_errors, size_t *nerrs) {
@@ -62,6 +63,85 @@ double run_trials(double ber, unsigned int n_errors) {
     return 1.0 - ((double)successes / (double)num_trials);
 }
 
+/* Standard normal by Box-Muller. */
+double randn(void) {
+    double u1 = ((double)rand() + 1.0) / ((double)RAND_MAX + 1.0);
+    double u2 = (double)rand() / (double)RAND_MAX;
+    return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+}
+
+/*
+ * Send blocks as BPSK over AWGN at `ebn0` dB and decode each twice, by hard
+ * decisions through interleaved_to_coded and coded_to_data and from LLRs
+ * through hamming_soft_decode_blocks. Writes data bit and block error rates.
+ */
+void run_awgn_trials(double ebn0, double ber[2], double per[2]) {
+    const int num_trials = 20000;
+    const double sigma = sqrt(1.0 / (2.0 * (4.0/7.0) * pow(10.0, ebn0/10.0)));
+    uint8_t data_tx[16], data_rx[2][16];
+    uint8_t coded[32], interleaved[28];
+    float llrs[224];
+    size_t bit_errs[2] = {0, 0}, block_errs[2] = {0, 0};
+    int t, i, j, k;
+
+    for(t=0; t<num_trials; t++) {
+        for(i=0; i<16; i++) {
+            data_tx[i] = rand() & 0xFF;
+        }
+        data_to_coded(data_tx, coded);
+        coded_to_interleaved(coded, interleaved);
+
+        for(i=0; i<224; i++) {
+            int bit = (interleaved[i/8] >> (i%8)) & 1;
+            double y = (bit ? -1.0 : 1.0) + sigma * randn();
+            llrs[i] = 2.0 * y / (sigma * sigma);
+        }
+
+        memset(interleaved, 0, sizeof(interleaved));
+        for(i=0; i<224; i++) {
+            if(llrs[i] <= 0) {
+                interleaved[i/8] |= 1 << (i%8);
+            }
+        }
+        interleaved_to_coded(interleaved, coded);
+        coded_to_data(coded, data_rx[0]);
+        hamming_soft_decode_blocks(llrs, data_rx[1], 1);
+
+        for(k=0; k<2; k++) {
+            bool bad = false;
+            for(i=0; i<16; i++) {
+                uint8_t diff = data_rx[k][i] ^ data_tx[i];
+                for(j=0; j<8; j++) {
+                    bit_errs[k] += (diff >> j) & 1;
+                }
+                bad |= diff != 0;
+            }
+            block_errs[k] += bad;
+        }
+    }
+
+    for(k=0; k<2; k++) {
+        ber[k] = (double)bit_errs[k] / (num_trials * 128.0);
+        per[k] = (double)block_errs[k] / num_trials;
+    }
+}
+
+/*
+ * Eb/N0 where the BER curve `ber` sampled at `ebn0` crosses `target`,
+ * interpolating log BER linearly, or NAN if it never does.
+ */
+double ebn0_at(const double* ebn0, const double* ber, int n, double target) {
+    int i;
+    for(i=1; i<n; i++) {
+        if(ber[i-1] >= target && ber[i] < target && ber[i] > 0) {
+            double f = (log(ber[i-1]) - log(target))
+                       / (log(ber[i-1]) - log(ber[i]));
+            return ebn0[i-1] + f * (ebn0[i] - ebn0[i-1]);
+        }
+    }
+    return NAN;
+}
+
 int main(int argc, char* argv[]) {
     (void)argc;
     (void)argv;
@@ -84,5 +164,21 @@ int main(int argc, char* argv[]) {
         printf("%.03f\t%.04f\n", ber, perr);
     }
 
+    double ebn0[11], ber_hard[11], ber_soft[11];
+    printf("\nEb/N0\tuncoded\tBER hard\tBER soft\tPerr hard\tPerr soft\n");
+    for(i=0; i<11; i++) {
+        double ber[2], per[2];
+        ebn0[i] = i;
+        run_awgn_trials(ebn0[i], ber, per);
+        ber_hard[i] = ber[0];
+        ber_soft[i] = ber[1];
+        printf("%.1f\t%.2e\t%.2e\t%.2e\t%.2e\t%.2e\n", ebn0[i],
+               0.5 * erfc(sqrt(pow(10.0, ebn0[i]/10.0))),
+               ber[0], ber[1], per[0], per[1]);
+    }
+    printf("soft decoding gain at BER 1e-4: %.2f dB\n",
+           ebn0_at(ebn0, ber_hard, 11, 1e-4)
+           - ebn0_at(ebn0, ber_soft, 11, 1e-4));
+
     return 0;
 }
@@ -1,19 +1,97 @@
 #include "ldpc_decoder.h"
 #include "ldpc_parity_check.h"
 #include "ldpc_parity_check_packed.h"
-#include <stdlib.h>
+#include "ldpc_syndrome.h"
 #include <stdbool.h>
 #include <stdio.h>
-#include <string.h>
+#include <stdlib.h>
 #include <math.h>
+#include <pthread.h>
 
 /* Use the compact int64_t parity check matrix? */
 #define USE_COMPACT_H 0
 
-/* Choose check node update algoritm. */
-#define USE_TANH 1
-#define USE_TANH_APPROX 0
-#define USE_MINSUM 0
+/* Check node kernel used by ldpc_decode and new contexts.
+ * Override with -DLDPC_DEFAULT_KERNEL=LDPC_KERNEL_... to change at build time.
+ */
+#ifndef LDPC_DEFAULT_KERNEL
+#define LDPC_DEFAULT_KERNEL LDPC_KERNEL_TANH
+#endif
+
+/* Number of ones in the parity check matrix. */
+#define N_EDGES 1024
+
+/* Largest tanh product passed to atanh, limiting messages to about 28. */
+#define TANH_MAX_PROD (1.0 - 1e-12)
+
+/* The phi lookup table covers [0, PHI_LUT_MAX) in PHI_LUT_SIZE steps,
+ * sampling phi at the middle of each step. phi(PHI_LUT_MAX) is about 2e-7,
+ * so larger inputs are treated as 0.
+ */
+#define PHI_LUT_SIZE 1024
+#define PHI_LUT_MAX  16.0
+
+/* Bit flipping iterations tried before belief propagation by ldpc_decode
+ * and new contexts. Override with -DLDPC_DEFAULT_BITFLIP_ITERS=0 to disable.
+ */
+#ifndef LDPC_DEFAULT_BITFLIP_ITERS
+#define LDPC_DEFAULT_BITFLIP_ITERS 16
+#endif
+
+/* Weight of a variable's own channel reliability in its bit flipping score. */
+#define BITFLIP_ALPHA 0.5
+
+/* Scale factor applied to normalised min-sum messages. */
+#define NMS_ALPHA 0.75
+
+/* Offset subtracted from offset min-sum messages. */
+#define OMS_BETA 0.5
+
+/* Edge list and lookup table built from the parity check matrix.
+ * Edges are numbered row by row, so check i owns edges row_start[i] to
+ * row_start[i+1]-1, and edge_col[e] and edge_row[e] are the variable and
+ * check connected by edge e. col_edges[col_start[a]] to
+ * col_edges[col_start[a+1]-1] are the edges of variable a.
+ */
+typedef struct {
+    uint16_t row_start[129];
+    uint16_t edge_col[N_EDGES];
+    uint16_t edge_row[N_EDGES];
+    uint16_t col_start[257];
+    uint16_t col_edges[N_EDGES];
+    double phi_lut[PHI_LUT_SIZE];
+} ldpc_graph;
+
+/* Message workspace for one decode. u[e] is the check to variable message
+ * and v[e] the variable to check message along edge e, t[e] is scratch for
+ * the check node kernels, and llrs holds the current marginals.
+ * check_weight and flip_score are used by the bit flipping stage.
+ */
+typedef struct {
+    double u[N_EDGES];
+    double v[N_EDGES];
+    double t[N_EDGES];
+    double llrs[256];
+    double check_weight[128];
+    double flip_score[256];
+} ldpc_workspace;
+
+struct ldpc_ctx {
+    ldpc_kernel kernel;
+    int bitflip_iters;
+    ldpc_graph graph;
+    ldpc_workspace ws;
+};
+
+/* Edge list used by ldpc_decode, built on first use. */
+static ldpc_graph default_graph;
+static pthread_once_t default_graph_once = PTHREAD_ONCE_INIT;
+
+/* Kernel used by ldpc_decode. */
+static ldpc_kernel default_kernel = LDPC_DEFAULT_KERNEL;
+
+/* Bit flipping iterations tried by ldpc_decode. */
+static int default_bitflip_iters = LDPC_DEFAULT_BITFLIP_ITERS;
 
 /* See if i and a are connected. */
 static inline bool ldpc_h(int i, int a)
@@ -26,28 +104,6 @@ static inline bool ldpc_h(int i, int a)
 
 }
 
-/* Check if x.H=0 implying that we have finished. */
-static bool ldpc_check_if_codeword(uint8_t* coded)
-{
-    int i, a;
-    /* For each parity check equation */
-    for(i=0; i<128; i++) {
-        int parity = 0;
-
-        /* For each coded bit */
-        for(a=0; a<256; a++) {
-            if(!ldpc_h(i, a)) continue;
-            parity += (coded[a/8] >> (7 - (a%8))) & 1;
-        }
-
-        /* Return false at the first violated parity check. */
-        if(parity % 2 != 0)
-            return false;
-    }
-
-    return true;
-}
-
 static inline double sign(double x)
 {
     return (x > 0) - (x < 0);
@@ -66,110 +122,359 @@ static inline double phi(double x)
     return log((exp(x)+1)/(exp(x)-1));
 }
 
-/* Decode 256 LLRs into 32 bytes of codeword in `coded`. */
-void ldpc_decode(double* r, uint8_t* coded)
+/* Look up phi(x) for x >= 0. */
+static inline double phi_lut(const double* lut, double x)
 {
-    int iter, a, b, i, j;
-    double **u, **v, *llrs;
-    const int max_iters = 100;
+    int idx = (int)(x * (PHI_LUT_SIZE / PHI_LUT_MAX));
+    return idx < PHI_LUT_SIZE ? lut[idx] : 0.0;
+}
 
-    /* Check if we can return early. */
-    memset(coded, 0, 32);
-    for(a=0; a<256; a++) {
-        coded[a/8] |= (r[a] < 0.0f) << (7 - (a % 8));
+/* Check node kernels.
+ * Each computes the check to variable messages u[e0..e1-1] for one check
+ * from its variable to check messages v[e0..e1-1], using t as scratch.
+ * The message on each edge excludes that edge's own input, which is done
+ * with prefix and suffix products for tanh, by subtracting the edge's own
+ * term for phi, and by keeping the two smallest magnitudes for min-sum.
+ */
+
+/* Exact sum-product: u_e = 2 atanh( prod_[f!=e] tanh(v_f / 2) ). */
+static inline void check_tanh(const ldpc_graph* g, const double* v,
+                              double* u, double* t, int e0, int e1)
+{
+    double prod;
+    int e;
+    (void)g;
+
+    prod = 1.0;
+    for(e=e0; e<e1; e++) {
+        t[e] = tanh(v[e] / 2.0);
+        u[e] = prod;
+        prod *= t[e];
     }
-    if(ldpc_check_if_codeword(coded)) {
-        /*printf("Codeword already valid, returning.\n");*/
-        return;
+
+    prod = 1.0;
+    for(e=e1-1; e>=e0; e--) {
+        double p = u[e] * prod;
+        prod *= t[e];
+        /* Keep atanh finite when every other message is certain. */
+        p = fmax(fmin(p, TANH_MAX_PROD), -TANH_MAX_PROD);
+        u[e] = 2.0 * atanh(p);
     }
+}
+
+/* Sum-product in the log domain with a phi lookup table:
+ * u_e = prod_[f!=e] sign(v_f) * phi( sum_[f!=e] phi(|v_f|) ).
+ */
+static inline void check_phi_lut(const ldpc_graph* g, const double* v,
+                                 double* u, double* t, int e0, int e1)
+{
+    double sum = 0.0, sgn = 1.0;
+    int e;
 
-    /* Allocate memory for u i->a */
-    u = (double**)malloc(128 * sizeof(double*));
-    u[0] = (double*)malloc(128 * 256 * sizeof(double));
-    for(i=1; i<128; i++) {
-        u[i] = u[0] + i * 256;
+    for(e=e0; e<e1; e++) {
+        t[e] = phi_lut(g->phi_lut, fabs(v[e]));
+        sum += t[e];
+        sgn = v[e] < 0.0 ? -sgn : sgn;
     }
 
-    /* Allocate memory for v a->i */
-    v = (double**)malloc(256 * sizeof(double*));
-    v[0] = (double*)malloc(256 * 128 * sizeof(double));
-    for(a=1; a<256; a++) {
-        v[a] = v[0] + a * 128;
+    for(e=e0; e<e1; e++) {
+        double mag = phi_lut(g->phi_lut, fmax(sum - t[e], 0.0));
+        u[e] = v[e] < 0.0 ? -sgn * mag : sgn * mag;
     }
+}
 
-    /* Allocate memory for the LLRs */
-    llrs = (double*)malloc(256 * sizeof(double));
+/* Min-sum with the two smallest magnitudes corrected by `correct`. */
+static inline void check_minsum_generic(const double* v, double* u,
+                                        int e0, int e1,
+                                        double (*correct)(double))
+{
+    double min1 = INFINITY, min2 = INFINITY, sgn = 1.0, mag;
+    int e, min_e = e0;
 
-    /* Initialisation */
+    for(e=e0; e<e1; e++) {
+        mag = fabs(v[e]);
+        sgn = v[e] < 0.0 ? -sgn : sgn;
+        if(mag < min1) {
+            min2 = min1;
+            min1 = mag;
+            min_e = e;
+        } else if(mag < min2) {
+            min2 = mag;
+        }
+    }
+
+    min1 = correct(min1);
+    min2 = correct(min2);
+
+    for(e=e0; e<e1; e++) {
+        mag = (e == min_e) ? min2 : min1;
+        u[e] = v[e] < 0.0 ? -sgn * mag : sgn * mag;
+    }
+}
+
+static inline double correct_none(double x)
+{
+    return x;
+}
+
+static inline double correct_offset(double x)
+{
+    return fmax(x - OMS_BETA, 0.0);
+}
+
+static inline double correct_normalised(double x)
+{
+    return x * NMS_ALPHA;
+}
+
+static inline void check_minsum(const ldpc_graph* g, const double* v,
+                                double* u, double* t, int e0, int e1)
+{
+    (void)g; (void)t;
+    check_minsum_generic(v, u, e0, e1, correct_none);
+}
+
+static inline void check_offset_minsum(const ldpc_graph* g, const double* v,
+                                       double* u, double* t, int e0, int e1)
+{
+    (void)g; (void)t;
+    check_minsum_generic(v, u, e0, e1, correct_offset);
+}
+
+static inline void check_normalised_minsum(const ldpc_graph* g,
+                                           const double* v, double* u,
+                                           double* t, int e0, int e1)
+{
+    (void)g; (void)t;
+    check_minsum_generic(v, u, e0, e1, correct_normalised);
+}
+
+typedef void (*check_kernel)(const ldpc_graph*, const double*, double*,
+                             double*, int, int);
+
+/* Build the edge list and lookup table `g` from the parity check matrix. */
+static void ldpc_build_graph(ldpc_graph* g)
+{
+    int i, a, e;
+
+    e = 0;
+    for(i=0; i<128; i++) {
+        g->row_start[i] = e;
+        for(a=0; a<256; a++) {
+            if(ldpc_h(i, a)) {
+                g->edge_row[e] = i;
+                g->edge_col[e++] = a;
+            }
+        }
+    }
+    g->row_start[128] = e;
+
+    e = 0;
     for(a=0; a<256; a++) {
-        llrs[a] = r[a];
-        for(i=0; i<128; i++) {
-            if(!ldpc_h(i, a)) continue;
-            v[a][i] = r[a];
+        g->col_start[a] = e;
+        for(i=0; i<N_EDGES; i++)
+            if(g->edge_col[i] == a)
+                g->col_edges[e++] = i;
+    }
+    g->col_start[256] = e;
+
+    for(i=0; i<PHI_LUT_SIZE; i++) {
+        g->phi_lut[i] = phi((i + 0.5) * (PHI_LUT_MAX / PHI_LUT_SIZE));
+    }
+}
+
+static void build_default_graph(void)
+{
+    ldpc_build_graph(&default_graph);
+}
+
+void ldpc_init()
+{
+    pthread_once(&default_graph_once, build_default_graph);
+}
+
+void ldpc_set_kernel(ldpc_kernel kernel)
+{
+    default_kernel = kernel;
+}
+
+void ldpc_set_bitflip_iters(int iters)
+{
+    default_bitflip_iters = iters;
+}
+
+/* Test and flip bit a of a packed hard decision or syndrome. */
+static inline bool packed_bit(const uint64_t* p, int a)
+{
+    return (p[a / 64] >> (63 - (a % 64))) & 1;
+}
+
+static inline void packed_flip(uint64_t* p, int a)
+{
+    p[a / 64] ^= 1ULL << (63 - (a % 64));
+}
+
+/* Modified weighted bit flipping on the packed hard decision `hard` of the
+ * channel LLRs `r`, which has `weight` unsatisfied checks.
+ *
+ * Each check i is weighted by w_i, the smallest |r| among its variables,
+ * and each variable a is scored by
+ *     E_a = sum over its checks i of (i unsatisfied ? w_i : -w_i)
+ *           - BITFLIP_ALPHA * |r_a|,
+ * so unreliable bits in many failed checks score highest. Each iteration
+ * flips the highest scoring bit and updates the syndrome and the scores of
+ * its neighbours incrementally, which costs a few dozen operations rather
+ * than a pass over every edge.
+ *
+ * Stops once the syndrome clears or after max_iters flips, counting them in
+ * stats->bitflip_iterations. Returns true if `hard` is now a codeword.
+ */
+static bool ldpc_bitflip(const ldpc_graph* g, ldpc_workspace* ws,
+                         const double* r, uint64_t hard[4], int weight,
+                         int max_iters, ldpc_stats* stats)
+{
+    int iter, i, a, e, f, idx, best;
+    const uint16_t* row_start = g->row_start;
+    const uint16_t* edge_col = g->edge_col;
+    const uint16_t* edge_row = g->edge_row;
+    const uint16_t* col_start = g->col_start;
+    const uint16_t* col_edges = g->col_edges;
+    double* w = ws->check_weight;
+    double* score = ws->flip_score;
+    uint64_t syndrome[2];
+
+    ldpc_syndrome(hard, syndrome);
+
+    for(i=0; i<128; i++) {
+        w[i] = INFINITY;
+        for(e=row_start[i]; e<row_start[i+1]; e++) {
+            w[i] = fmin(w[i], fabs(r[edge_col[e]]));
+        }
+    }
+
+    for(a=0; a<256; a++) {
+        score[a] = -BITFLIP_ALPHA * fabs(r[a]);
+        for(idx=col_start[a]; idx<col_start[a+1]; idx++) {
+            i = edge_row[col_edges[idx]];
+            score[a] += packed_bit(syndrome, i) ? w[i] : -w[i];
+        }
+    }
+
+    for(iter=0; iter<max_iters && weight != 0; iter++) {
+        best = 0;
+        for(a=1; a<256; a++) {
+            if(score[a] > score[best]) {
+                best = a;
+            }
+        }
+
+        /* Flipping `best` toggles each of its checks, moving the score of
+         * every variable in that check by twice the check's weight.
+         */
+        packed_flip(hard, best);
+        for(idx=col_start[best]; idx<col_start[best+1]; idx++) {
+            double delta;
+            i = edge_row[col_edges[idx]];
+            packed_flip(syndrome, i);
+            if(packed_bit(syndrome, i)) {
+                weight++;
+                delta = 2.0 * w[i];
+            } else {
+                weight--;
+                delta = -2.0 * w[i];
+            }
+            for(f=row_start[i]; f<row_start[i+1]; f++) {
+                score[edge_col[f]] += delta;
+            }
         }
     }
 
+    stats->bitflip_iterations = iter;
+    stats->syndrome_weight = weight;
+    return weight == 0;
+}
+
+/* Decode 256 LLRs `r` into 32 bytes of codeword in `coded` using the edge
+ * list `g` and messages in `ws`, filling in `stats`, with `check` as the
+ * check node update. Always inlined with a constant `check`, so each kernel
+ * gets its own copy of the decoder with the kernel inlined into it.
+ * Returns true if `coded` is a valid codeword.
+ */
+static inline __attribute__((always_inline))
+bool ldpc_decode_generic(const ldpc_graph* g, ldpc_workspace* ws,
+                         const double* r, uint8_t* coded, int bitflip_iters,
+                         ldpc_stats* stats, check_kernel check)
+{
+    int iter, i, a, e, idx, weight;
+    const uint16_t* row_start = g->row_start;
+    const uint16_t* edge_col = g->edge_col;
+    const uint16_t* col_start = g->col_start;
+    const uint16_t* col_edges = g->col_edges;
+    double* u = ws->u;
+    double* v = ws->v;
+    double* llrs = ws->llrs;
+    uint64_t hard[4];
+    const int max_iters = 100;
+
+    /* Check if we can return early. */
+    ldpc_hard_decision(r, hard);
+    weight = ldpc_syndrome_weight(hard);
+    stats->initial_syndrome_weight = weight;
+    stats->syndrome_weight = weight;
+    stats->iterations = 0;
+    stats->bitflip_iterations = 0;
+    stats->stage = LDPC_STAGE_HARD;
+    if(weight == 0) {
+        /*printf("Codeword already valid, returning.\n");*/
+        ldpc_hard_to_bytes(hard, coded);
+        return true;
+    }
+
+    /* Try the cheap hard decision stage before belief propagation. */
+    if(bitflip_iters > 0 &&
+       ldpc_bitflip(g, ws, r, hard, weight, bitflip_iters, stats)) {
+        stats->stage = LDPC_STAGE_BITFLIP;
+        ldpc_hard_to_bytes(hard, coded);
+        return true;
+    }
+    stats->stage = LDPC_STAGE_BP;
+
+    /* Initialisation */
+    for(e=0; e<N_EDGES; e++) {
+        v[e] = r[edge_col[e]];
+    }
+
     /*printf("[00] LLR[0]=%f\n", llrs[0]);*/
 
     /* Cap max iterations. */
     for(iter=0; iter<max_iters; iter++) {
         /* Check nodes to variable nodes */
         for(i=0; i<128; i++) {
-            for(a=0; a<256; a++) {
-                if(!ldpc_h(i, a)) continue;
-#if USE_TANH
-                u[i][a] = 1.0f;
-                for(b=0; b<256; b++) {
-                    if(!ldpc_h(i, b) || b==a) continue;
-                    u[i][a] *= tanh(v[b][i] / 2.0f);
-                }
-                u[i][a] = 2.0f * atanh(u[i][a]);
-#endif
-#if USE_TANH_APPROX
-                u[i][a] = 0.0f;
-                double prodsign = 1.0f;
-                for(b=0; b<256; b++) {
-                    if(!ldpc_h(i, b) || b==a) continue;
-                    u[i][a] += phi(fabs(v[b][i]));
-                    prodsign *= sign(v[b][i]);
-                }
-                u[i][a] = prodsign * phi(u[i][a]);
-#endif
-#if USE_MINSUM
-                u[i][a] = 9999.9f;
-                for(b=0; b<256; b++) {
-                    if(!ldpc_h(i, b) || b==a) continue;
-                    u[i][a] = sign(u[i][a]) * sign(v[b][i]) * fmin(fabs(u[i][a]), fabs(v[b][i]));
-                    /*u[i][a] = minstar(u[i][a], v[b][i]);*/
-                }
-#endif
-            }
+            check(g, v, u, ws->t, row_start[i], row_start[i+1]);
         }
 
         /* Check if we're done. */
-        memset(coded, 0, 32);
         for(a=0; a<256; a++) {
             llrs[a] = r[a];
-            for(i=0; i<128; i++) {
-                llrs[a] += u[i][a];
+            for(idx=col_start[a]; idx<col_start[a+1]; idx++) {
+                llrs[a] += u[col_edges[idx]];
             }
-            coded[a/8] |= (llrs[a] <= 0.0) << (7 - (a % 8));
         }
+        ldpc_hard_decision(llrs, hard);
+        weight = ldpc_syndrome_weight(hard);
+        stats->iterations = iter + 1;
+        stats->syndrome_weight = weight;
         /*printf("[%02d] LLR[0]=%f\n", iter, llrs[0]);*/
-        if(ldpc_check_if_codeword(coded)) {
+        if(weight == 0) {
             /*printf("Codeword found after %d iters, returning.\n", iter);*/
             break;
         }
 
         /* Variable nodes to check nodes */
         for(a=0; a<256; a++) {
-            for(i=0; i<128; i++) {
-                if(!ldpc_h(i, a)) continue;
-                v[a][i] = r[a];
-                for(j=0; j<128; j++) {
-                    if(!ldpc_h(j, a) || j==i) continue;
-                    v[a][i] += u[j][a];
-                }
+            for(idx=col_start[a]; idx<col_start[a+1]; idx++) {
+                e = col_edges[idx];
+                v[e] = llrs[a] - u[e];
             }
         }
 
@@ -179,9 +484,133 @@ void ldpc_decode(double* r, uint8_t* coded)
         /*printf("Max iterations exceeded, returning.\n");*/
     }
 
-    free(v[0]);
-    free(v);
-    free(u[0]);
-    free(u);
-    free(llrs);
+    if(weight != 0) {
+        stats->stage = LDPC_STAGE_FAILED;
+    }
+
+    ldpc_hard_to_bytes(hard, coded);
+    return weight == 0;
+}
+
+static bool ldpc_decode_tanh(const ldpc_graph* g, ldpc_workspace* ws,
+                             const double* r, uint8_t* coded,
+                             int bitflip_iters, ldpc_stats* stats)
+{
+    return ldpc_decode_generic(g, ws, r, coded, bitflip_iters, stats,
+                               check_tanh);
+}
+
+static bool ldpc_decode_phi_lut(const ldpc_graph* g, ldpc_workspace* ws,
+                                const double* r, uint8_t* coded,
+                                int bitflip_iters, ldpc_stats* stats)
+{
+    return ldpc_decode_generic(g, ws, r, coded, bitflip_iters, stats,
+                               check_phi_lut);
+}
+
+static bool ldpc_decode_minsum(const ldpc_graph* g, ldpc_workspace* ws,
+                               const double* r, uint8_t* coded,
+                               int bitflip_iters, ldpc_stats* stats)
+{
+    return ldpc_decode_generic(g, ws, r, coded, bitflip_iters, stats,
+                               check_minsum);
+}
+
+static bool ldpc_decode_offset_minsum(const ldpc_graph* g,
+                                      ldpc_workspace* ws, const double* r,
+                                      uint8_t* coded, int bitflip_iters,
+                                      ldpc_stats* stats)
+{
+    return ldpc_decode_generic(g, ws, r, coded, bitflip_iters, stats,
+                               check_offset_minsum);
+}
+
+static bool ldpc_decode_normalised_minsum(const ldpc_graph* g,
+                                          ldpc_workspace* ws,
+                                          const double* r, uint8_t* coded,
+                                          int bitflip_iters,
+                                          ldpc_stats* stats)
+{
+    return ldpc_decode_generic(g, ws, r, coded, bitflip_iters, stats,
+                               check_normalised_minsum);
+}
+
+/* Pick the specialised decoder for `kernel`, once per frame. */
+static bool ldpc_decode_kernel(ldpc_kernel kernel, const ldpc_graph* g,
+                               ldpc_workspace* ws, const double* r,
+                               uint8_t* coded, int bitflip_iters,
+                               ldpc_stats* stats)
+{
+    ldpc_stats unused;
+
+    if(stats == NULL) {
+        stats = &unused;
+    }
+
+    switch(kernel) {
+    case LDPC_KERNEL_PHI_LUT:
+        return ldpc_decode_phi_lut(g, ws, r, coded, bitflip_iters, stats);
+    case LDPC_KERNEL_MINSUM:
+        return ldpc_decode_minsum(g, ws, r, coded, bitflip_iters, stats);
+    case LDPC_KERNEL_OFFSET_MINSUM:
+        return ldpc_decode_offset_minsum(g, ws, r, coded, bitflip_iters,
+                                         stats);
+    case LDPC_KERNEL_NORMALISED_MINSUM:
+        return ldpc_decode_normalised_minsum(g, ws, r, coded, bitflip_iters,
+                                             stats);
+    case LDPC_KERNEL_TANH:
+    default:
+        return ldpc_decode_tanh(g, ws, r, coded, bitflip_iters, stats);
+    }
+}
+
+/* Decode 256 LLRs into 32 bytes of codeword in `coded`. */
+void ldpc_decode(double* r, uint8_t* coded)
+{
+    ldpc_decode_stats(r, coded, NULL);
+}
+
+/* Decode 256 LLRs into 32 bytes of codeword in `coded`, filling in `stats`.
+ * The messages live on the stack, so this is reentrant, but prefer an
+ * ldpc_ctx where stack space is tight.
+ */
+void ldpc_decode_stats(double* r, uint8_t* coded, ldpc_stats* stats)
+{
+    ldpc_workspace ws;
+    ldpc_init();
+    ldpc_decode_kernel(default_kernel, &default_graph, &ws, r, coded,
+                       default_bitflip_iters, stats);
+}
+
+ldpc_ctx* ldpc_ctx_new(void)
+{
+    ldpc_ctx* ctx = malloc(sizeof(ldpc_ctx));
+    if(ctx != NULL) {
+        ctx->kernel = LDPC_DEFAULT_KERNEL;
+        ctx->bitflip_iters = LDPC_DEFAULT_BITFLIP_ITERS;
+        ldpc_build_graph(&ctx->graph);
+    }
+    return ctx;
+}
+
+void ldpc_ctx_free(ldpc_ctx* ctx)
+{
+    free(ctx);
+}
+
+void ldpc_ctx_set_kernel(ldpc_ctx* ctx, ldpc_kernel kernel)
+{
+    ctx->kernel = kernel;
+}
+
+void ldpc_ctx_set_bitflip_iters(ldpc_ctx* ctx, int iters)
+{
+    ctx->bitflip_iters = iters;
+}
+
+bool ldpc_ctx_decode(ldpc_ctx* ctx, const double* llrs, uint8_t* coded,
+                     ldpc_stats* stats)
+{
+    return ldpc_decode_kernel(ctx->kernel, &ctx->graph, &ctx->ws, llrs,
+                              coded, ctx->bitflip_iters, stats);
 }
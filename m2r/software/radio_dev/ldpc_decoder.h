@@ -1,9 +1,103 @@
 #ifndef LDPC_DECODER_H
 #define LDPC_DECODER_H
 
+#include <stdbool.h>
 #include <stdint.h>
 
+/* Check node update rules, selected with ldpc_set_kernel or
+ * ldpc_ctx_set_kernel, or at build time by defining LDPC_DEFAULT_KERNEL.
+ *
+ * LDPC_KERNEL_TANH is the exact sum-product rule using tanh and atanh.
+ * LDPC_KERNEL_PHI_LUT is the same rule in the log domain, with
+ * phi(x) = -log(tanh(x/2)) read from a lookup table.
+ * LDPC_KERNEL_MINSUM approximates it with the smallest input magnitude,
+ * and the offset and normalised variants correct that overestimate by
+ * subtracting a constant or scaling by a factor.
+ */
+typedef enum {
+    LDPC_KERNEL_TANH,
+    LDPC_KERNEL_PHI_LUT,
+    LDPC_KERNEL_MINSUM,
+    LDPC_KERNEL_OFFSET_MINSUM,
+    LDPC_KERNEL_NORMALISED_MINSUM,
+} ldpc_kernel;
+
+/* Decoder stages, in the order they are tried. A frame whose hard decision
+ * is already a codeword needs no decoding. Otherwise a few cheap iterations
+ * of weighted bit flipping on the packed hard decision are tried, and only
+ * if they do not clear the syndrome does belief propagation run, starting
+ * again from the channel LLRs.
+ */
+typedef enum {
+    LDPC_STAGE_HARD,
+    LDPC_STAGE_BITFLIP,
+    LDPC_STAGE_BP,
+    LDPC_STAGE_FAILED,
+} ldpc_stage;
+
+/* Statistics about one decode, for measuring convergence. */
+typedef struct {
+    /* Number of belief propagation iterations run before the decoder
+     * stopped, 0 if an earlier stage succeeded.
+     */
+    int iterations;
+
+    /* Unsatisfied parity checks in the hard decision of the channel LLRs. */
+    int initial_syndrome_weight;
+
+    /* Unsatisfied parity checks when the decoder stopped, 0 on success. */
+    int syndrome_weight;
+
+    /* Stage that produced the codeword, or LDPC_STAGE_FAILED. */
+    ldpc_stage stage;
+
+    /* Number of bit flipping iterations run. */
+    int bitflip_iterations;
+} ldpc_stats;
+
+/* Build the edge list used by ldpc_decode from the parity check matrix.
+ * ldpc_decode does this itself on first use, so calling this is optional;
+ * it just moves the one-off cost to startup.
+ */
+void ldpc_init(void);
+
+/* Select the kernel used by subsequent calls to ldpc_decode. */
+void ldpc_set_kernel(ldpc_kernel kernel);
+
+/* Set the most bit flipping iterations tried by ldpc_decode before belief
+ * propagation, 0 to go straight to belief propagation.
+ */
+void ldpc_set_bitflip_iters(int iters);
+
 /* Decode 256 LLRs into 32 bytes of codeword in `coded`. */
 void ldpc_decode(double* llrs, uint8_t* coded);
 
+/* As ldpc_decode, also filling in `stats` unless it is NULL. */
+void ldpc_decode_stats(double* llrs, uint8_t* coded, ldpc_stats* stats);
+
+/* A decoder context owns its own copy of the edge list and the message
+ * workspace, so decoding with it never allocates and any number of
+ * contexts can decode concurrently, one per thread.
+ */
+typedef struct ldpc_ctx ldpc_ctx;
+
+/* Allocate and initialise a decoder context. Returns NULL if out of memory. */
+ldpc_ctx* ldpc_ctx_new(void);
+
+/* Free a context from ldpc_ctx_new. */
+void ldpc_ctx_free(ldpc_ctx* ctx);
+
+/* Select the kernel used by subsequent decodes with `ctx`. */
+void ldpc_ctx_set_kernel(ldpc_ctx* ctx, ldpc_kernel kernel);
+
+/* Set the most bit flipping iterations tried by `ctx`, 0 to disable. */
+void ldpc_ctx_set_bitflip_iters(ldpc_ctx* ctx, int iters);
+
+/* Decode 256 LLRs into 32 bytes of codeword in `coded` using `ctx`,
+ * filling in `stats` unless it is NULL.
+ * Returns true if `coded` is a valid codeword.
+ */
+bool ldpc_ctx_decode(ldpc_ctx* ctx, const double* llrs, uint8_t* coded,
+                     ldpc_stats* stats);
+
 #endif /* LDPC_DECODER_H */
@@ -10,8 +10,10 @@ static const uint32_t ldpc_256_128_w[4][4] = {
     {0xBAA37B32, 0x60CB31C5, 0xD0F66A31, 0xFAF511BC}
 };
 
-/* Encode 16 bytes of `data` to 32 bytes of `coded`. */
-void ldpc_encode(uint8_t* data, uint8_t* coded)
+/* Encode 16 bytes of `data` to 32 bytes of `coded`, one bit at a time.
+ * Kept as the reference for ldpc_encode.
+ */
+void ldpc_encode_bitwise(uint8_t* data, uint8_t* coded)
 {
     int i, j;
 
@@ -60,3 +62,62 @@ void ldpc_encode(uint8_t* data, uint8_t* coded)
         coded[16+id8] |= (parity % 2) << (7 - im8);
     }
 }
+
+static inline uint32_t ror32(uint32_t x, int k)
+{
+    return (x >> k) | (x << ((32 - k) & 31));
+}
+
+static inline void put_be32(uint8_t* p, uint32_t x)
+{
+    p[0] = x >> 24;
+    p[1] = x >> 16;
+    p[2] = x >> 8;
+    p[3] = x;
+}
+
+/* Encode 16 bytes of `data` to 32 bytes of `coded`.
+ *
+ * The generator is quasi-cyclic: data bit j = 32*jd + k contributes the
+ * constant ldpc_256_128_w[jd][b] rotated right by k to parity word b, where
+ * parity word b holds parity bits 32*b to 32*b+31 MSb first. So for each
+ * data bit we XOR four rotated words into the parity, using a mask rather
+ * than a branch so the run time does not depend on the data.
+ */
+void ldpc_encode(uint8_t* data, uint8_t* coded)
+{
+    uint32_t p0 = 0, p1 = 0, p2 = 0, p3 = 0;
+    int jd, k;
+
+    for(jd=0; jd<4; jd++) {
+        uint32_t d = (uint32_t)data[4*jd+0] << 24 |
+                     (uint32_t)data[4*jd+1] << 16 |
+                     (uint32_t)data[4*jd+2] << 8  |
+                     (uint32_t)data[4*jd+3];
+        const uint32_t* w = ldpc_256_128_w[jd];
+        for(k=0; k<32; k++) {
+            uint32_t mask = -((d >> (31 - k)) & 1);
+            p0 ^= ror32(w[0], k) & mask;
+            p1 ^= ror32(w[1], k) & mask;
+            p2 ^= ror32(w[2], k) & mask;
+            p3 ^= ror32(w[3], k) & mask;
+        }
+    }
+
+    memcpy(coded, data, 16);
+    put_be32(coded + 16, p0);
+    put_be32(coded + 20, p1);
+    put_be32(coded + 24, p2);
+    put_be32(coded + 28, p3);
+}
+
+/* Encode `n` frames of 16 bytes from `data` into `n` frames of 32 bytes in
+ * `coded`.
+ */
+void ldpc_encode_batch(const uint8_t* data, uint8_t* coded, size_t n)
+{
+    size_t i;
+    for(i=0; i<n; i++) {
+        ldpc_encode((uint8_t*)data + 16*i, coded + 32*i);
+    }
+}
@@ -1,9 +1,18 @@
 #ifndef LDPC_ENCODER_H
 #define LDPC_ENCODER_H
 
+#include <stddef.h>
 #include <stdint.h>
 
 /* Encode 16 bytes of `data` to 32 bytes of `coded`. */
 void ldpc_encode(uint8_t* data, uint8_t* coded);
 
+/* Encode `n` frames of 16 bytes from `data` into `n` frames of 32 bytes in
+ * `coded`.
+ */
+void ldpc_encode_batch(const uint8_t* data, uint8_t* coded, size_t n);
+
+/* Slow bit at a time encoder, bit-exact with ldpc_encode, for testing. */
+void ldpc_encode_bitwise(uint8_t* data, uint8_t* coded);
+
 #endif /* LDPC_ENCODER_H */
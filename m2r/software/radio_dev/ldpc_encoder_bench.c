@@ -0,0 +1,103 @@
+/* Check ldpc_encode against the bitwise reference encoder and time both.
+ *
+ * Usage: ldpc_encoder_bench [frames]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include "ldpc_encoder.h"
+
+static uint64_t xorshift_state = 0x2545F4914F6CDD1DULL;
+
+static uint64_t xorshift64s(void)
+{
+    xorshift_state ^= xorshift_state >> 12;
+    xorshift_state ^= xorshift_state << 25;
+    xorshift_state ^= xorshift_state >> 27;
+    return xorshift_state * 0x2545F4914F6CDD1DULL;
+}
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Compare both encoders on one frame of data, returning 0 if they agree. */
+static int check(uint8_t* data)
+{
+    uint8_t ref[32], fast[32];
+    ldpc_encode_bitwise(data, ref);
+    ldpc_encode(data, fast);
+    return memcmp(ref, fast, 32) != 0;
+}
+
+int main(int argc, char* argv[])
+{
+    size_t nframes = 100000, i;
+    uint8_t *data, *coded;
+    uint8_t frame[16];
+    unsigned int sink = 0;
+    int errors = 0, bit;
+    double t0, t1, t_ref, t_fast, t_batch;
+
+    if(argc > 1) {
+        nframes = strtoul(argv[1], NULL, 10);
+    }
+
+    data = malloc(16 * nframes);
+    coded = malloc(32 * nframes);
+    for(i=0; i<16*nframes; i+=8) {
+        uint64_t r = xorshift64s();
+        memcpy(data + i, &r, 8);
+    }
+
+    /* Every single bit input exercises each generator row on its own. */
+    for(bit=0; bit<128; bit++) {
+        memset(frame, 0, 16);
+        frame[bit/8] = 1 << (7 - (bit % 8));
+        errors += check(frame);
+    }
+    memset(frame, 0xFF, 16);
+    errors += check(frame);
+    for(i=0; i<nframes && i<10000; i++) {
+        errors += check(data + 16*i);
+    }
+    printf("Mismatches against reference encoder: %d\n", errors);
+
+    t0 = now();
+    for(i=0; i<nframes/100; i++) {
+        ldpc_encode_bitwise(data + 16*i, coded + 32*i);
+        sink += coded[32*i + 31];
+    }
+    t1 = now();
+    t_ref = (t1 - t0) / (nframes/100);
+
+    t0 = now();
+    for(i=0; i<nframes; i++) {
+        ldpc_encode(data + 16*i, coded + 32*i);
+    }
+    t1 = now();
+    t_fast = (t1 - t0) / nframes;
+    sink += coded[31];
+
+    t0 = now();
+    ldpc_encode_batch(data, coded, nframes);
+    t1 = now();
+    t_batch = (t1 - t0) / nframes;
+    sink += coded[63];
+
+    printf("Encoder\t\tns/frame\tframes/s\n");
+    printf("bitwise\t\t%.1f\t\t%.0f\n", t_ref*1e9, 1.0/t_ref);
+    printf("quasi-cyclic\t%.1f\t\t%.0f\n", t_fast*1e9, 1.0/t_fast);
+    printf("batch\t\t%.1f\t\t%.0f\n", t_batch*1e9, 1.0/t_batch);
+    printf("(%u)\n", sink & 1);
+
+    free(data);
+    free(coded);
+    return errors != 0;
+}
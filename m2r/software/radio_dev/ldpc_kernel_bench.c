@@ -0,0 +1,149 @@
+/* Time each check node kernel and measure its PER on the same frames, then
+ * do the same for a range of bit flipping iterations before the default
+ * kernel, counting which stage decoded each frame.
+ *
+ * Usage: ldpc_kernel_bench [frames per point]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "ldpc_encoder.h"
+#include "ldpc_decoder.h"
+
+static uint64_t xorshift_state = 0x2545F4914F6CDD1DULL;
+
+static uint64_t xorshift64s(void)
+{
+    xorshift_state ^= xorshift_state >> 12;
+    xorshift_state ^= xorshift_state << 25;
+    xorshift_state ^= xorshift_state >> 27;
+    return xorshift_state * 0x2545F4914F6CDD1DULL;
+}
+
+/* Uniform double in (0, 1]. */
+static double randu(void)
+{
+    return ((xorshift64s() >> 11) + 1) * (1.0 / 9007199254740992.0);
+}
+
+static double randn(void)
+{
+    return sqrt(-2.0 * log(randu())) * cos(2.0 * M_PI * randu());
+}
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static const struct {
+    ldpc_kernel kernel;
+    const char* name;
+} kernels[] = {
+    {LDPC_KERNEL_TANH, "tanh"},
+    {LDPC_KERNEL_PHI_LUT, "phi LUT"},
+    {LDPC_KERNEL_MINSUM, "min-sum"},
+    {LDPC_KERNEL_OFFSET_MINSUM, "offset MS"},
+    {LDPC_KERNEL_NORMALISED_MINSUM, "normalised MS"},
+};
+
+int main(int argc, char* argv[])
+{
+    const double ebn0s[] = {2.0, 2.5, 3.0, 3.5, 4.0, 4.5};
+    const int bitflips[] = {0, 8, 16, 32};
+    int nframes = 1000, p, k, f, i;
+    uint8_t* data;
+    double* llrs;
+    ldpc_ctx* ctx;
+
+    if(argc > 1) {
+        nframes = atoi(argv[1]);
+    }
+
+    data = malloc(16 * nframes);
+    llrs = malloc(256 * sizeof(double) * nframes);
+    ctx = ldpc_ctx_new();
+    if(data == NULL || llrs == NULL || ctx == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+
+    printf("Eb/N0\tkernel\t\tPER\t\tus/frame\titers\n");
+    for(p=0; p<(int)(sizeof(ebn0s)/sizeof(ebn0s[0])); p++) {
+        double sigma = sqrt(1.0 / pow(10.0, ebn0s[p] / 10.0));
+
+        /* Generate one set of frames for every kernel to decode. */
+        for(f=0; f<nframes; f++) {
+            uint8_t coded[32];
+            for(i=0; i<16; i++) {
+                data[16*f + i] = xorshift64s() & 0xFF;
+            }
+            ldpc_encode(&data[16*f], coded);
+            for(i=0; i<256; i++) {
+                int bit = (coded[i/8] >> (7 - (i % 8))) & 1;
+                double y = (bit ? -1.0 : 1.0) + randn() * sigma;
+                llrs[256*f + i] = 2.0 * y / (sigma * sigma);
+            }
+        }
+
+        for(k=0; k<(int)(sizeof(kernels)/sizeof(kernels[0])); k++) {
+            int errors = 0;
+            long iters = 0;
+            double t0, t1;
+
+            ldpc_ctx_set_kernel(ctx, kernels[k].kernel);
+            ldpc_ctx_set_bitflip_iters(ctx, 0);
+            t0 = now();
+            for(f=0; f<nframes; f++) {
+                uint8_t decoded[32];
+                ldpc_stats stats;
+                ldpc_ctx_decode(ctx, &llrs[256*f], decoded, &stats);
+                errors += memcmp(decoded, &data[16*f], 16) != 0;
+                iters += stats.iterations;
+            }
+            t1 = now();
+
+            printf("%.1f\t%-13s\t%.3e\t%.1f\t\t%.2f\n", ebn0s[p],
+                   kernels[k].name, (double)errors / nframes,
+                   (t1 - t0) * 1e6 / nframes, (double)iters / nframes);
+        }
+
+        printf("\n\tbitflip		PER		us/frame	hard	flip	BP\n");
+        ldpc_ctx_set_kernel(ctx, kernels[0].kernel);
+        for(k=0; k<(int)(sizeof(bitflips)/sizeof(bitflips[0])); k++) {
+            int errors = 0, stages[LDPC_STAGE_FAILED + 1] = {0};
+            double t0, t1;
+
+            ldpc_ctx_set_bitflip_iters(ctx, bitflips[k]);
+            t0 = now();
+            for(f=0; f<nframes; f++) {
+                uint8_t decoded[32];
+                ldpc_stats stats;
+                ldpc_ctx_decode(ctx, &llrs[256*f], decoded, &stats);
+                errors += memcmp(decoded, &data[16*f], 16) != 0;
+                stages[stats.stage]++;
+            }
+            t1 = now();
+
+            printf("%.1f	%d		%.3e	%.1f		%.1f%%	%.1f%%	%.1f%%\n",
+                   ebn0s[p], bitflips[k], (double)errors / nframes,
+                   (t1 - t0) * 1e6 / nframes,
+                   100.0 * stages[LDPC_STAGE_HARD] / nframes,
+                   100.0 * stages[LDPC_STAGE_BITFLIP] / nframes,
+                   100.0 * (stages[LDPC_STAGE_BP] + stages[LDPC_STAGE_FAILED])
+                         / nframes);
+        }
+        printf("\n");
+    }
+
+    ldpc_ctx_free(ctx);
+    free(llrs);
+    free(data);
+    return 0;
+}
@@ -0,0 +1,504 @@
+/* Parallel Monte Carlo BER/PER harness for the (256,128) LDPC decoders.
+ *
+ * Encodes random frames, sends them over a BPSK AWGN channel and decodes
+ * them with either the radio_dev decoder (libcldpcd.so) or the ground
+ * decoder (ground/libldpc/build/libldpc.so). Both are loaded at runtime
+ * and called through their common ldpc_ctx interface, with one decoder
+ * context per worker thread.
+ *
+ * Frames are simulated in blocks of BLOCK_FRAMES spread over all cores.
+ * Each block seeds its own RNG from the seed, SNR point and block number,
+ * and blocks are tallied strictly in order, so results depend only on the
+ * seed and options and not on the number of threads or their scheduling.
+ *
+ * Usage: ldpc_mc [options]
+ *   -b radio|ground    decoder to load (default radio)
+ *   -l path            shared library path (default per decoder)
+ *   -m spa|nms|oms|fixed  ground decoder mode (default fixed)
+ *   -s, -e, -d dB      Eb/N0 start, end and step (default 1.0, 3.0, 0.5)
+ *   -E errors          stop each point after this many frame errors (100)
+ *   -n frames          or after this many frames (10000000)
+ *   -t threads         worker threads (default number of cores)
+ *   -S seed            RNG seed (default 1)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <dlfcn.h>
+#include <pthread.h>
+#include "ldpc_encoder.h"
+#include "ldpc_decoder.h"
+
+#define BLOCK_FRAMES (256)
+#define MAX_ITERS    (100)
+#define HIST_BINS    (MAX_ITERS + 1)
+
+/* The ground decoder's ldpc_ctx_new takes a mode and the radio decoder's
+ * takes nothing, otherwise the interfaces match. The radio decoder writes
+ * the whole 32 byte codeword and the ground decoder the 16 data bytes,
+ * so either way the first 16 bytes out are the decoded data.
+ */
+typedef ldpc_ctx* (*radio_ctx_new_fn)(void);
+typedef ldpc_ctx* (*ground_ctx_new_fn)(int);
+typedef void (*ctx_free_fn)(ldpc_ctx*);
+typedef bool (*ctx_decode_fn)(ldpc_ctx*, const double*, uint8_t*,
+                              ldpc_stats*);
+
+/* Values of the ground decoder's ldpc_mode, LDPC_MODE_FLOODING_SPA to
+ * LDPC_MODE_LAYERED_NMS_FIXED in ground/libldpc/ldpc_decoder.h, whose
+ * header clashes with the radio decoder's so cannot be included here.
+ * Keep this table in the same order as that enum.
+ */
+static const struct {
+    const char* name;
+    int mode;
+} ground_modes[] = {
+    {"spa", 0},     /* LDPC_MODE_FLOODING_SPA */
+    {"nms", 1},     /* LDPC_MODE_LAYERED_NMS */
+    {"oms", 2},     /* LDPC_MODE_LAYERED_OMS */
+    {"fixed", 3},   /* LDPC_MODE_LAYERED_NMS_FIXED */
+};
+#define N_GROUND_MODES (int)(sizeof(ground_modes) / sizeof(ground_modes[0]))
+
+typedef struct {
+    bool ground;
+    int mode;
+    radio_ctx_new_fn radio_ctx_new;
+    ground_ctx_new_fn ground_ctx_new;
+    ctx_free_fn ctx_free;
+    ctx_decode_fn ctx_decode;
+} decoder;
+
+/* Tallies for one block of frames, or for a whole SNR point. */
+typedef struct {
+    uint64_t frames;
+    uint64_t frame_errors;
+    uint64_t bit_errors;
+    uint64_t iter_hist[HIST_BINS];
+} tally;
+
+/* State shared between the workers for one SNR point. */
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+
+    const decoder* dec;
+    double sigma;
+    uint64_t seed;
+    uint64_t max_blocks;
+    uint64_t target_errors;
+
+    /* Next block to hand out, and next block to fold into `total`. */
+    uint64_t next_claim;
+    uint64_t next_merge;
+    bool done;
+
+    /* Finished blocks waiting for an earlier block to be merged first,
+     * indexed by block number modulo `window`.
+     */
+    size_t window;
+    tally* pending;
+    bool* pending_ready;
+
+    tally total;
+} point_state;
+
+/* xoshiro256+ seeded through splitmix64. */
+typedef struct {
+    uint64_t s[4];
+} rng;
+
+static uint64_t splitmix64(uint64_t* x)
+{
+    uint64_t z = (*x += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static void rng_seed(rng* r, uint64_t seed)
+{
+    int i;
+    for(i=0; i<4; i++) {
+        r->s[i] = splitmix64(&seed);
+    }
+}
+
+static inline uint64_t rotl(uint64_t x, int k)
+{
+    return (x << k) | (x >> (64 - k));
+}
+
+static inline uint64_t rng_next(rng* r)
+{
+    uint64_t result = r->s[0] + r->s[3];
+    uint64_t t = r->s[1] << 17;
+    r->s[2] ^= r->s[0];
+    r->s[3] ^= r->s[1];
+    r->s[1] ^= r->s[2];
+    r->s[0] ^= r->s[3];
+    r->s[2] ^= t;
+    r->s[3] = rotl(r->s[3], 45);
+    return result;
+}
+
+/* Uniform double in (-1, 1). */
+static inline double rng_uniform_pm1(rng* r)
+{
+    return (double)(int64_t)rng_next(r) * (1.0 / 9223372036854775808.0);
+}
+
+/* Fill `out` with n standard normal samples using the Marsaglia polar
+ * method, which needs no trig and yields two samples per accepted pair.
+ */
+static void rng_normals(rng* r, double* out, int n)
+{
+    int i;
+    for(i=0; i<n; i+=2) {
+        double u, v, s, f;
+        do {
+            u = rng_uniform_pm1(r);
+            v = rng_uniform_pm1(r);
+            s = u*u + v*v;
+        } while(s >= 1.0 || s == 0.0);
+        f = sqrt(-2.0 * log(s) / s);
+        out[i] = u * f;
+        if(i + 1 < n) {
+            out[i+1] = v * f;
+        }
+    }
+}
+
+/* Simulate one block of frames into `t`. */
+static void run_block(point_state* ps, ldpc_ctx* ctx, uint64_t block,
+                      tally* t)
+{
+    uint8_t data[16], coded[32], decoded[32];
+    double noise[256], llrs[256];
+    const double scale = 2.0 / (ps->sigma * ps->sigma);
+    ldpc_stats stats;
+    rng r;
+    int f, i;
+
+    memset(t, 0, sizeof(*t));
+    rng_seed(&r, ps->seed ^ (block * 0xD1B54A32D192ED03ULL));
+
+    for(f=0; f<BLOCK_FRAMES; f++) {
+        uint64_t d0 = rng_next(&r), d1 = rng_next(&r);
+        int bit_errors = 0;
+        memcpy(data, &d0, 8);
+        memcpy(data + 8, &d1, 8);
+        ldpc_encode(data, coded);
+
+        /* BPSK with bit 0 sent as +1, so positive LLRs mean 0. */
+        rng_normals(&r, noise, 256);
+        for(i=0; i<256; i++) {
+            int bit = (coded[i/8] >> (7 - (i % 8))) & 1;
+            double y = (bit ? -1.0 : 1.0) + noise[i] * ps->sigma;
+            llrs[i] = scale * y;
+        }
+
+        memset(decoded, 0, sizeof(decoded));
+        ps->dec->ctx_decode(ctx, llrs, decoded, &stats);
+
+        for(i=0; i<16; i++) {
+            bit_errors += __builtin_popcount(data[i] ^ decoded[i]);
+        }
+
+        t->frames++;
+        t->frame_errors += bit_errors != 0;
+        t->bit_errors += bit_errors;
+        if(stats.iterations > MAX_ITERS) {
+            stats.iterations = MAX_ITERS;
+        }
+        t->iter_hist[stats.iterations]++;
+    }
+}
+
+static void tally_add(tally* dst, const tally* src)
+{
+    int i;
+    dst->frames += src->frames;
+    dst->frame_errors += src->frame_errors;
+    dst->bit_errors += src->bit_errors;
+    for(i=0; i<HIST_BINS; i++) {
+        dst->iter_hist[i] += src->iter_hist[i];
+    }
+}
+
+static void* worker(void* arg)
+{
+    point_state* ps = arg;
+    const decoder* dec = ps->dec;
+    ldpc_ctx* ctx;
+    tally t;
+
+    ctx = dec->ground ? dec->ground_ctx_new(dec->mode) : dec->radio_ctx_new();
+    if(ctx == NULL) {
+        fprintf(stderr, "Out of memory creating decoder context\n");
+        exit(1);
+    }
+
+    pthread_mutex_lock(&ps->lock);
+    for(;;) {
+        uint64_t block;
+
+        /* Don't run too far ahead of the oldest unmerged block. */
+        while(!ps->done && ps->next_claim - ps->next_merge >= ps->window) {
+            pthread_cond_wait(&ps->cond, &ps->lock);
+        }
+        if(ps->done || ps->next_claim >= ps->max_blocks) {
+            break;
+        }
+        block = ps->next_claim++;
+        pthread_mutex_unlock(&ps->lock);
+
+        run_block(ps, ctx, block, &t);
+
+        pthread_mutex_lock(&ps->lock);
+        ps->pending[block % ps->window] = t;
+        ps->pending_ready[block % ps->window] = true;
+
+        /* Merge blocks in order, stopping at the first block which takes
+         * the error count to the target, so the outcome is deterministic.
+         */
+        while(!ps->done && ps->pending_ready[ps->next_merge % ps->window]) {
+            size_t slot = ps->next_merge % ps->window;
+            tally_add(&ps->total, &ps->pending[slot]);
+            ps->pending_ready[slot] = false;
+            ps->next_merge++;
+            if(ps->total.frame_errors >= ps->target_errors ||
+               ps->next_merge >= ps->max_blocks) {
+                ps->done = true;
+            }
+        }
+        pthread_cond_broadcast(&ps->cond);
+    }
+    pthread_mutex_unlock(&ps->lock);
+    dec->ctx_free(ctx);
+    return NULL;
+}
+
+/* 95% Wilson score interval for k successes out of n trials. */
+static void wilson(uint64_t k, uint64_t n, double* lo, double* hi)
+{
+    const double z = 1.959964;
+    double p, denom, centre, half;
+    if(n == 0) {
+        *lo = 0.0;
+        *hi = 1.0;
+        return;
+    }
+    p = (double)k / (double)n;
+    denom = 1.0 + z*z/n;
+    centre = (p + z*z/(2.0*n)) / denom;
+    half = z * sqrt(p*(1.0-p)/n + z*z/(4.0*n*n)) / denom;
+    *lo = centre - half > 0.0 ? centre - half : 0.0;
+    *hi = centre + half < 1.0 ? centre + half : 1.0;
+}
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void usage(const char* argv0)
+{
+    fprintf(stderr,
+        "Usage: %s [-b radio|ground] [-l lib.so] [-m spa|nms|oms|fixed]\n"
+        "          [-s start_dB] [-e end_dB] [-d step_dB] [-E errors]\n"
+        "          [-n max_frames] [-t threads] [-S seed]\n", argv0);
+}
+
+int main(int argc, char* argv[])
+{
+    const char* backend = "radio";
+    const char* lib_path = NULL;
+    const char* mode = "fixed";
+    double start_db = 1.0, end_db = 3.0, step_db = 0.5;
+    uint64_t target_errors = 100, max_frames = 10000000, seed = 1;
+    long n_threads = sysconf(_SC_NPROCESSORS_ONLN);
+    tally* totals;
+    double* points;
+    int n_points, p, i, opt;
+    void* lib;
+    decoder dec;
+    pthread_t* threads;
+
+    while((opt = getopt(argc, argv, "b:l:m:s:e:d:E:n:t:S:h")) != -1) {
+        switch(opt) {
+        case 'b': backend = optarg; break;
+        case 'l': lib_path = optarg; break;
+        case 'm': mode = optarg; break;
+        case 's': start_db = atof(optarg); break;
+        case 'e': end_db = atof(optarg); break;
+        case 'd': step_db = atof(optarg); break;
+        case 'E': target_errors = strtoull(optarg, NULL, 0); break;
+        case 'n': max_frames = strtoull(optarg, NULL, 0); break;
+        case 't': n_threads = atol(optarg); break;
+        case 'S': seed = strtoull(optarg, NULL, 0); break;
+        default: usage(argv[0]); return 1;
+        }
+    }
+    if(n_threads < 1) {
+        n_threads = 1;
+    }
+    if(step_db <= 0.0 || end_db < start_db || max_frames < 1) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    memset(&dec, 0, sizeof(dec));
+    if(strcmp(backend, "ground") == 0) {
+        dec.ground = true;
+        if(lib_path == NULL) {
+            lib_path = "../../../ground/libldpc/build/libldpc.so";
+        }
+    } else if(strcmp(backend, "radio") == 0) {
+        if(lib_path == NULL) {
+            lib_path = "./libcldpcd.so";
+        }
+    } else {
+        usage(argv[0]);
+        return 1;
+    }
+
+    lib = dlopen(lib_path, RTLD_NOW | RTLD_LOCAL);
+    if(lib == NULL) {
+        fprintf(stderr, "Error loading decoder: %s\n", dlerror());
+        return 1;
+    }
+
+    {
+        void (*init)(void) = (void (*)(void))dlsym(lib, "ldpc_init");
+        void* ctx_new = dlsym(lib, "ldpc_ctx_new");
+        dec.ctx_free = (ctx_free_fn)dlsym(lib, "ldpc_ctx_free");
+        dec.ctx_decode = (ctx_decode_fn)dlsym(lib, "ldpc_ctx_decode");
+        if(init == NULL || ctx_new == NULL || dec.ctx_free == NULL ||
+           dec.ctx_decode == NULL) {
+            fprintf(stderr, "Decoder library is missing ldpc_init or the "
+                            "ldpc_ctx functions\n");
+            return 1;
+        }
+        init();
+        if(dec.ground) {
+            dec.ground_ctx_new = (ground_ctx_new_fn)ctx_new;
+        } else {
+            dec.radio_ctx_new = (radio_ctx_new_fn)ctx_new;
+        }
+    }
+
+    if(dec.ground) {
+        dec.mode = -1;
+        for(i=0; i<N_GROUND_MODES; i++) {
+            if(strcmp(mode, ground_modes[i].name) == 0)
+                dec.mode = ground_modes[i].mode;
+        }
+        if(dec.mode < 0) {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    n_points = (int)floor((end_db - start_db) / step_db + 1e-9) + 1;
+    totals = calloc(n_points, sizeof(tally));
+    points = calloc(n_points, sizeof(double));
+    threads = calloc(n_threads, sizeof(pthread_t));
+    if(totals == NULL || points == NULL || threads == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        exit(1);
+    }
+
+    printf("Decoder: %s (%s%s%s), %ld threads, seed %llu\n",
+           backend, lib_path, dec.ground ? ", " : "", dec.ground ? mode : "",
+           n_threads, (unsigned long long)seed);
+    printf("Eb/N0\tFrames\t\tPER\t\tPER 95%% CI\t\t\tBER\t\tBER 95%% CI"
+           "\t\t\tAvg iters\tFrames/s\n");
+
+    for(p=0; p<n_points; p++) {
+        point_state ps;
+        double ebn0_db = start_db + p * step_db;
+        double t0, t1, per_lo, per_hi, ber_lo, ber_hi, avg_iters = 0.0;
+        uint64_t bits;
+        tally* t = &totals[p];
+
+        points[p] = ebn0_db;
+
+        memset(&ps, 0, sizeof(ps));
+        pthread_mutex_init(&ps.lock, NULL);
+        pthread_cond_init(&ps.cond, NULL);
+        ps.dec = &dec;
+        ps.sigma = sqrt(1.0 / pow(10.0, ebn0_db / 10.0));
+        ps.seed = seed * 0x9E3779B97F4A7C15ULL + (uint64_t)p;
+        ps.max_blocks = (max_frames + BLOCK_FRAMES - 1) / BLOCK_FRAMES;
+        ps.target_errors = target_errors;
+        ps.window = 4 * n_threads;
+        ps.pending = calloc(ps.window, sizeof(tally));
+        ps.pending_ready = calloc(ps.window, sizeof(bool));
+        if(ps.pending == NULL || ps.pending_ready == NULL) {
+            fprintf(stderr, "Out of memory\n");
+            exit(1);
+        }
+
+        t0 = now();
+        for(i=0; i<n_threads; i++) {
+            if(pthread_create(&threads[i], NULL, worker, &ps) != 0) {
+                fprintf(stderr, "Error starting thread\n");
+                exit(1);
+            }
+        }
+        for(i=0; i<n_threads; i++) {
+            pthread_join(threads[i], NULL);
+        }
+        t1 = now();
+
+        *t = ps.total;
+        bits = t->frames * 128;
+        wilson(t->frame_errors, t->frames, &per_lo, &per_hi);
+        wilson(t->bit_errors, bits, &ber_lo, &ber_hi);
+        for(i=0; i<HIST_BINS; i++) {
+            avg_iters += (double)i * t->iter_hist[i];
+        }
+        avg_iters /= t->frames;
+
+        printf("%.2f\t%-10llu\t%.3e\t[%.3e, %.3e]\t%.3e\t[%.3e, %.3e]"
+               "\t%.2f\t\t%.0f\n",
+               ebn0_db, (unsigned long long)t->frames,
+               (double)t->frame_errors / t->frames, per_lo, per_hi,
+               (double)t->bit_errors / bits, ber_lo, ber_hi,
+               avg_iters, t->frames / (t1 - t0));
+        fflush(stdout);
+
+        free(ps.pending);
+        free(ps.pending_ready);
+        pthread_cond_destroy(&ps.cond);
+        pthread_mutex_destroy(&ps.lock);
+    }
+
+    /* Iteration histograms, one line per point, "iterations:frames". */
+    printf("\nIteration histograms\n");
+    for(p=0; p<n_points; p++) {
+        printf("%.2f\t", points[p]);
+        for(i=0; i<HIST_BINS; i++) {
+            if(totals[p].iter_hist[i]) {
+                printf(" %d:%llu", i,
+                       (unsigned long long)totals[p].iter_hist[i]);
+            }
+        }
+        printf("\n");
+    }
+
+    free(threads);
+    free(points);
+    free(totals);
+    dlclose(lib);
+    return 0;
+}
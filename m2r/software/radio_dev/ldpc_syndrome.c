@@ -0,0 +1,57 @@
+#include "ldpc_syndrome.h"
+#include "ldpc_parity_check_packed.h"
+
+/* Hard decide 256 LLRs into four 64 bit words. */
+void ldpc_hard_decision(const double* llrs, uint64_t hard[4])
+{
+    int w, b;
+    for(w=0; w<4; w++) {
+        uint64_t word = 0;
+        for(b=0; b<64; b++) {
+            word = (word << 1) | (llrs[w*64 + b] <= 0.0);
+        }
+        hard[w] = word;
+    }
+}
+
+/* Count the parity checks not satisfied by `hard`.
+ * A check is satisfied when it covers an even number of ones, so AND its
+ * row of H with the hard decision, XOR the four words together, and take
+ * the parity of the popcount.
+ */
+int ldpc_syndrome_weight(const uint64_t hard[4])
+{
+    int i, weight = 0;
+    for(i=0; i<128; i++) {
+        uint64_t acc = (ldpc_parity_p[i][0] & hard[0])
+                     ^ (ldpc_parity_p[i][1] & hard[1])
+                     ^ (ldpc_parity_p[i][2] & hard[2])
+                     ^ (ldpc_parity_p[i][3] & hard[3]);
+        weight += __builtin_popcountll(acc) & 1;
+    }
+    return weight;
+}
+
+/* Compute the syndrome hard.H^T, one bit per check. */
+void ldpc_syndrome(const uint64_t hard[4], uint64_t syndrome[2])
+{
+    int i;
+    syndrome[0] = syndrome[1] = 0;
+    for(i=0; i<128; i++) {
+        uint64_t acc = (ldpc_parity_p[i][0] & hard[0])
+                     ^ (ldpc_parity_p[i][1] & hard[1])
+                     ^ (ldpc_parity_p[i][2] & hard[2])
+                     ^ (ldpc_parity_p[i][3] & hard[3]);
+        syndrome[i/64] |= (uint64_t)(__builtin_popcountll(acc) & 1)
+                          << (63 - (i % 64));
+    }
+}
+
+/* Unpack `hard` into 32 bytes of codeword. */
+void ldpc_hard_to_bytes(const uint64_t hard[4], uint8_t* coded)
+{
+    int i;
+    for(i=0; i<32; i++) {
+        coded[i] = hard[i/8] >> (56 - 8*(i % 8));
+    }
+}
@@ -0,0 +1,25 @@
+#ifndef LDPC_SYNDROME_H
+#define LDPC_SYNDROME_H
+
+#include <stdint.h>
+
+/* Hard decide 256 LLRs into four 64 bit words, in the same layout as
+ * ldpc_parity_p: bit a is bit 63 - (a % 64) of word a / 64, and is set
+ * wherever llrs[a] <= 0.
+ */
+void ldpc_hard_decision(const double* llrs, uint64_t hard[4]);
+
+/* Count the parity checks not satisfied by `hard`, i.e. the weight of the
+ * syndrome hard.H^T. Returns 0 if and only if `hard` is a codeword.
+ */
+int ldpc_syndrome_weight(const uint64_t hard[4]);
+
+/* Compute the syndrome hard.H^T into `syndrome`, with check i in bit
+ * 63 - (i % 64) of word i / 64, set if that check is unsatisfied.
+ */
+void ldpc_syndrome(const uint64_t hard[4], uint64_t syndrome[2]);
+
+/* Unpack `hard` into 32 bytes of codeword in `coded`, MSb first. */
+void ldpc_hard_to_bytes(const uint64_t hard[4], uint8_t* coded);
+
+#endif /* LDPC_SYNDROME_H */
@@ -6,6 +6,7 @@
 #include <math.h>
 #include "ldpc_encoder.h"
 #include "ldpc_decoder.h"
+#include "llr.h"
 
 double randn()
 {
@@ -18,6 +19,7 @@ bool run_trial(double snr)
 {
     uint8_t data_tx[16], coded_tx[32], coded_rx[32], data_rx[16];
     double llrs[256];
+    float y[256];
     double sigma = sqrt(1.0f / snr);
     double tx_pwr = 0.0f, noise_pwr = 0.0f;
     int i;
@@ -36,31 +38,22 @@ bool run_trial(double snr)
         uint8_t coded_byte = i / 8;
         uint8_t coded_bit = 7 - (i % 8);
         uint8_t bit = (coded_tx[coded_byte] >> coded_bit) & 1;
-        double x, n, y, p_y_xp, p_y_xm, p_x1_y, p_x0_y;
-        uint8_t hard_decision;
-        char hard_correct;
+        double x, n;
 
+        /* Bit 0 is sent as +1, so positive LLRs mean 0. */
         if(bit)
-            x = 1.0;
-        else
             x = -1.0;
+        else
+            x = 1.0;
 
         n = randn() * sigma;
         tx_pwr += x*x;
         noise_pwr += n*n;
-        y = x + n;
-        p_y_xp = exp( -(y - 1)*(y - 1) / (2*sigma*sigma));
-        p_y_xm = exp( -(y + 1)*(y + 1) / (2*sigma*sigma));
-        p_x1_y = p_y_xp / (p_y_xp + p_y_xm);
-        p_x0_y = 1.0f - p_x1_y;
-        hard_decision = p_x1_y > p_x0_y;
-        hard_correct = hard_decision == bit ? 'y' : 'n';
-        (void)hard_correct;
-        /*printf("x=%+.0f\ty=%+.4f\tP(y|x=+)=%.4f\t P(y|x=-)=%.4f\t P(x=1|y)=%.4f\t P(x=0|y)=%.4f\t(%d: %c)\n", x, y, p_y_xp, p_y_xm, p_x1_y, p_x0_y, hard_decision, hard_correct);*/
-        llrs[i] = log(p_x0_y / p_x1_y);
-        /*printf("%.04f ", llrs[i]);*/
+        y[i] = x + n;
     }
 
+    llr_bpsk(y, llrs, 256, 1.0, sigma*sigma);
+
     tx_pwr /= 256.0f;
     noise_pwr /= 256.0f;
     (void)tx_pwr;
@@ -116,6 +109,7 @@ int main(int argc, char* argv[])
     (void)argc; (void)argv;
     srand(time(NULL));
     srand(0);
+    ldpc_init();
 
     printf("SNR (dB)\tPacket Err Rate\n");
     for(i=30; i<=30; i+=5) {
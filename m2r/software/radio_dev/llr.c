@@ -0,0 +1,225 @@
+#include "llr.h"
+#include <math.h>
+#include <string.h>
+
+/* Eight floats, which GCC maps to whatever SIMD registers the target has. */
+typedef float v8f __attribute__((vector_size(32)));
+
+#define LANES (8)
+#define BIT_VECS (LLR_FSK_SAMPLES_PER_BIT / LANES)
+
+#if LLR_FSK_SAMPLES_PER_BIT % LANES != 0
+#error "LLR_FSK_SAMPLES_PER_BIT must be a multiple of 8"
+#endif
+
+/* Cosine and sine of each tone over one bit, starting at phase 0 each bit
+ * as radio.c does.
+ */
+static v8f mark_cos[BIT_VECS], mark_sin[BIT_VECS];
+static v8f space_cos[BIT_VECS], space_sin[BIT_VECS];
+
+static inline v8f load8(const float* p)
+{
+    v8f v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline float sum8(v8f v)
+{
+    return ((v[0] + v[1]) + (v[2] + v[3])) + ((v[4] + v[5]) + (v[6] + v[7]));
+}
+
+void llr_bpsk(const float* restrict y, double* restrict llrs, size_t n,
+              double amp, double sigma2)
+{
+    const double k = 2.0 * amp / sigma2;
+    size_t i;
+
+    for(i=0; i<n; i++)
+        llrs[i] = k * y[i];
+}
+
+void llr_bpsk_noise_init(llr_bpsk_noise* est, double alpha)
+{
+    est->alpha = alpha;
+    est->m2 = est->m4 = 0.0;
+    est->blocks = 0;
+}
+
+void llr_bpsk_noise_update(llr_bpsk_noise* est, const float* y, size_t n)
+{
+    v8f s2 = {0}, s4 = {0};
+    double m2, m4;
+    size_t i;
+
+    if(n == 0)
+        return;
+
+    for(i=0; i+LANES<=n; i+=LANES) {
+        v8f v = load8(&y[i]);
+        v8f v2 = v * v;
+        s2 += v2;
+        s4 += v2 * v2;
+    }
+    m2 = sum8(s2);
+    m4 = sum8(s4);
+    for(; i<n; i++) {
+        double v2 = (double)y[i] * y[i];
+        m2 += v2;
+        m4 += v2 * v2;
+    }
+    m2 /= n;
+    m4 /= n;
+
+    /* The first block sets the moments outright. */
+    if(est->blocks++ == 0) {
+        est->m2 = m2;
+        est->m4 = m4;
+    } else {
+        est->m2 += est->alpha * (m2 - est->m2);
+        est->m4 += est->alpha * (m4 - est->m4);
+    }
+}
+
+void llr_bpsk_noise_get(const llr_bpsk_noise* est, double* amp,
+                        double* sigma2)
+{
+    double s;
+
+    if(est->blocks == 0) {
+        *amp = 1.0;
+        *sigma2 = 1.0;
+        return;
+    }
+
+    /* Sampling noise can push 3 m2^2 - m4 negative at very low SNR, and
+     * leave no noise at very high SNR, so clamp both.
+     */
+    s = sqrt(fmax((3.0 * est->m2 * est->m2 - est->m4) / 2.0, 0.0));
+    *amp = sqrt(s);
+    *sigma2 = fmax(est->m2 - s, 1e-6 * est->m2);
+}
+
+void llr_fsk_init()
+{
+    int i;
+    float c[LLR_FSK_SAMPLES_PER_BIT], s[LLR_FSK_SAMPLES_PER_BIT];
+
+    for(i=0; i<LLR_FSK_SAMPLES_PER_BIT; i++) {
+        c[i] = cos(2.0 * M_PI * LLR_FSK_MARK * i / LLR_FSK_FS);
+        s[i] = sin(2.0 * M_PI * LLR_FSK_MARK * i / LLR_FSK_FS);
+    }
+    memcpy(mark_cos, c, sizeof(c));
+    memcpy(mark_sin, s, sizeof(s));
+
+    for(i=0; i<LLR_FSK_SAMPLES_PER_BIT; i++) {
+        c[i] = cos(2.0 * M_PI * LLR_FSK_SPACE * i / LLR_FSK_FS);
+        s[i] = sin(2.0 * M_PI * LLR_FSK_SPACE * i / LLR_FSK_FS);
+    }
+    memcpy(space_cos, c, sizeof(c));
+    memcpy(space_sin, s, sizeof(s));
+}
+
+void llr_fsk_energies(const float* x, size_t nbits, float* e_mark,
+                      float* e_space)
+{
+    size_t b;
+    int k;
+
+    for(b=0; b<nbits; b++, x+=LLR_FSK_SAMPLES_PER_BIT) {
+        v8f mc = {0}, ms = {0}, sc = {0}, ss = {0};
+        float mi, mq, si, sq;
+
+        for(k=0; k<BIT_VECS; k++) {
+            v8f v = load8(&x[k*LANES]);
+            mc += v * mark_cos[k];
+            ms += v * mark_sin[k];
+            sc += v * space_cos[k];
+            ss += v * space_sin[k];
+        }
+
+        mi = sum8(mc);
+        mq = sum8(ms);
+        si = sum8(sc);
+        sq = sum8(ss);
+        e_mark[b] = mi*mi + mq*mq;
+        e_space[b] = si*si + sq*sq;
+    }
+}
+
+/* ln I0(x) for x >= 0, from the polynomial approximations to I0 in
+ * Abramowitz and Stegun 9.8.1 and 9.8.2, good to about 1e-7 relative.
+ */
+static double log_i0(double x)
+{
+    double t, u, p;
+
+    if(x < 3.75) {
+        t = (x / 3.75) * (x / 3.75);
+        p = 1.0 + t*(3.5156229 + t*(3.0899424 + t*(1.2067492
+                + t*(0.2659732 + t*(0.0360768 + t*0.0045813)))));
+        return log(p);
+    }
+
+    u = 3.75 / x;
+    p = 0.39894228 + u*(0.01328592 + u*(0.00225319 + u*(-0.00157565
+        + u*(0.00916281 + u*(-0.02057706 + u*(0.02635537
+        + u*(-0.01647633 + u*0.00392377)))))));
+    return x - 0.5 * log(x) + log(p);
+}
+
+void llr_fsk(const float* e_mark, const float* e_space, double* llrs,
+             size_t n, double amp, double sigma2)
+{
+    const double k = amp / sigma2;
+    size_t i;
+
+    for(i=0; i<n; i++)
+        llrs[i] = log_i0(k * sqrt(e_space[i])) - log_i0(k * sqrt(e_mark[i]));
+}
+
+void llr_fsk_noise_init(llr_fsk_noise* est, double alpha)
+{
+    est->alpha = alpha;
+    est->e_hi = est->e_lo = 0.0;
+    est->blocks = 0;
+}
+
+void llr_fsk_noise_update(llr_fsk_noise* est, const float* e_mark,
+                          const float* e_space, size_t n)
+{
+    double hi = 0.0, lo = 0.0;
+    size_t i;
+
+    if(n == 0)
+        return;
+
+    for(i=0; i<n; i++) {
+        hi += fmaxf(e_mark[i], e_space[i]);
+        lo += fminf(e_mark[i], e_space[i]);
+    }
+    hi /= n;
+    lo /= n;
+
+    if(est->blocks++ == 0) {
+        est->e_hi = hi;
+        est->e_lo = lo;
+    } else {
+        est->e_hi += est->alpha * (hi - est->e_hi);
+        est->e_lo += est->alpha * (lo - est->e_lo);
+    }
+}
+
+void llr_fsk_noise_get(const llr_fsk_noise* est, double* amp,
+                       double* sigma2)
+{
+    if(est->blocks == 0) {
+        *amp = 1.0;
+        *sigma2 = 1.0;
+        return;
+    }
+
+    *sigma2 = fmax(est->e_lo / 2.0, 1e-12);
+    *amp = sqrt(fmax(est->e_hi - est->e_lo, 0.0));
+}
@@ -0,0 +1,90 @@
+#ifndef LLR_H
+#define LLR_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Soft demodulation into LLRs for the LDPC decoders.
+ *
+ * Every kernel writes doubles with positive values meaning bit 0 is more
+ * likely, which is what ldpc_decode and ldpc_ctx_decode take, so frames of
+ * 256 outputs go straight to the decoder.
+ *
+ * Kernels work on blocks of samples at a time. Elementwise loops are left
+ * for the compiler to vectorise, and the reductions, which it will not
+ * reorder, use GCC vector extensions so they compile to SIMD on any target.
+ */
+
+/* BPSK =======================================================================
+ *
+ * Bit 0 is sent as +amp and bit 1 as -amp, with Gaussian noise of variance
+ * sigma2 added, so LLR = 2 amp y / sigma2.
+ */
+void llr_bpsk(const float* y, double* llrs, size_t n, double amp,
+              double sigma2);
+
+/* Online estimate of amp and sigma2 from the received samples alone, by
+ * the M2M4 moment method: for BPSK in real AWGN, with S = amp^2 and
+ * N = sigma2, E[y^2] = S + N and E[y^4] = S^2 + 6SN + 3N^2, which solve to
+ * S = sqrt((3 E[y^2]^2 - E[y^4]) / 2). The moments are averaged over each
+ * block and then exponentially across blocks, weighting each new block by
+ * `alpha`, so the estimate follows a slowly fading channel.
+ */
+typedef struct {
+    double alpha;
+    double m2, m4;
+    int blocks;
+} llr_bpsk_noise;
+
+void llr_bpsk_noise_init(llr_bpsk_noise* est, double alpha);
+void llr_bpsk_noise_update(llr_bpsk_noise* est, const float* y, size_t n);
+
+/* Current estimate, or amp 1 and sigma2 1 before any samples. */
+void llr_bpsk_noise_get(const llr_bpsk_noise* est, double* amp,
+                        double* sigma2);
+
+/* Non-coherent FSK ===========================================================
+ *
+ * The tones sent by m2r/firmware/radio.c: audio at LLR_FSK_FS, with
+ * LLR_FSK_SAMPLES_PER_BIT samples per bit, mark (bit 1) at LLR_FSK_MARK
+ * and space (bit 0) at LLR_FSK_SPACE.
+ */
+#define LLR_FSK_FS              (12000.0)
+#define LLR_FSK_SAMPLES_PER_BIT (80)
+#define LLR_FSK_MARK            (1000.0)
+#define LLR_FSK_SPACE           (1350.0)
+
+/* Build the tone tables. Call once before llr_fsk_energies. */
+void llr_fsk_init(void);
+
+/* Correlate `nbits` bit periods of bit-aligned audio `x` against both
+ * tones, writing each tone's energy, I^2 + Q^2, per bit.
+ */
+void llr_fsk_energies(const float* x, size_t nbits, float* e_mark,
+                      float* e_space);
+
+/* LLRs from tone energies. With each tone's correlator envelope r = sqrt(E),
+ * the tone's signal envelope `amp` and the noise variance `sigma2` of each
+ * of I and Q, LLR = ln I0(amp r_space / sigma2) - ln I0(amp r_mark / sigma2).
+ */
+void llr_fsk(const float* e_mark, const float* e_space, double* llrs,
+             size_t n, double amp, double sigma2);
+
+/* Online estimate of amp and sigma2 from the tone energies. Each bit has
+ * one tone carrying signal and one only noise, whose energy averages
+ * 2 sigma2, and the louder averages amp^2 + 2 sigma2. Picking the louder
+ * tone per bit biases both slightly at low SNR. Averaged as for BPSK.
+ */
+typedef struct {
+    double alpha;
+    double e_hi, e_lo;
+    int blocks;
+} llr_fsk_noise;
+
+void llr_fsk_noise_init(llr_fsk_noise* est, double alpha);
+void llr_fsk_noise_update(llr_fsk_noise* est, const float* e_mark,
+                          const float* e_space, size_t n);
+void llr_fsk_noise_get(const llr_fsk_noise* est, double* amp,
+                       double* sigma2);
+
+#endif /* LLR_H */
@@ -0,0 +1,248 @@
+/* Time the LLR kernels and check them against the channel they model.
+ *
+ * Reports samples per second on one core for each kernel, and for the
+ * exp/log BPSK LLR ldpc_test.c used before them. Then compares the online
+ * noise estimates with the true channel, and decodes FSK frames end to end
+ * using only the estimated parameters.
+ *
+ * Usage: llr_bench [frames per point]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "ldpc_encoder.h"
+#include "ldpc_decoder.h"
+#include "llr.h"
+
+/* Samples per timed block, and blocks per timing run. */
+#define BLOCK   (4096)
+#define BLOCKS  (256)
+
+static uint64_t xorshift_state = 0x2545F4914F6CDD1DULL;
+
+static uint64_t xorshift64s(void)
+{
+    xorshift_state ^= xorshift_state >> 12;
+    xorshift_state ^= xorshift_state << 25;
+    xorshift_state ^= xorshift_state >> 27;
+    return xorshift_state * 0x2545F4914F6CDD1DULL;
+}
+
+/* Uniform double in (0, 1]. */
+static double randu(void)
+{
+    return ((xorshift64s() >> 11) + 1) * (1.0 / 9007199254740992.0);
+}
+
+static double randn(void)
+{
+    return sqrt(-2.0 * log(randu())) * cos(2.0 * M_PI * randu());
+}
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* The LLR ldpc_test.c computed, with bit 0 sent as +1. */
+static double llr_reference(double y, double sigma)
+{
+    double p_y_xp = exp(-(y - 1)*(y - 1) / (2*sigma*sigma));
+    double p_y_xm = exp(-(y + 1)*(y + 1) / (2*sigma*sigma));
+    double p_x0_y = p_y_xp / (p_y_xp + p_y_xm);
+    return log(p_x0_y / (1.0 - p_x0_y));
+}
+
+/* Fill `x` with the audio for `nbits` bits from `bits`, tone amplitude 1,
+ * plus noise of standard deviation `sigma_n` per sample.
+ */
+static void fsk_modulate(const uint8_t* bits, size_t nbits, float* x,
+                         double sigma_n)
+{
+    size_t b;
+    int i;
+
+    for(b=0; b<nbits; b++) {
+        double f = bits[b] ? LLR_FSK_MARK : LLR_FSK_SPACE;
+        for(i=0; i<LLR_FSK_SAMPLES_PER_BIT; i++) {
+            *x++ = sin(2.0 * M_PI * f * i / LLR_FSK_FS) + sigma_n * randn();
+        }
+    }
+}
+
+static void bench_kernels(void)
+{
+    static float y[BLOCK], x[BLOCK * LLR_FSK_SAMPLES_PER_BIT / 16];
+    static float e_mark[BLOCK / 16], e_space[BLOCK / 16];
+    static uint8_t bits[BLOCK / 16];
+    static double llrs[BLOCK];
+    const size_t fsk_bits = BLOCK / 16;
+    const size_t fsk_samples = fsk_bits * LLR_FSK_SAMPLES_PER_BIT;
+    const double sigma = 0.7;
+    llr_bpsk_noise bn;
+    llr_fsk_noise fn;
+    double t0, t, amp, sigma2, sink = 0.0;
+    size_t i;
+    int k;
+
+    for(i=0; i<BLOCK; i++)
+        y[i] = (xorshift64s() & 1 ? -1.0 : 1.0) + sigma * randn();
+    for(i=0; i<fsk_bits; i++)
+        bits[i] = xorshift64s() & 1;
+    fsk_modulate(bits, fsk_bits, x, 1.0);
+
+    printf("Kernel\t\t\tsamples/s\n");
+
+    t0 = now();
+    for(k=0; k<BLOCKS/16; k++) {
+        for(i=0; i<BLOCK; i++)
+            llrs[i] = llr_reference(y[i], sigma);
+        sink += llrs[k];
+    }
+    t = now() - t0;
+    printf("BPSK exp/log\t\t%.3g\n", (double)BLOCK * (BLOCKS/16) / t);
+
+    t0 = now();
+    for(k=0; k<BLOCKS; k++) {
+        llr_bpsk(y, llrs, BLOCK, 1.0, sigma * sigma);
+        sink += llrs[k];
+    }
+    t = now() - t0;
+    printf("BPSK 2y/s^2\t\t%.3g\n", (double)BLOCK * BLOCKS / t);
+
+    llr_bpsk_noise_init(&bn, 0.1);
+    t0 = now();
+    for(k=0; k<BLOCKS; k++) {
+        llr_bpsk_noise_update(&bn, y, BLOCK);
+        llr_bpsk_noise_get(&bn, &amp, &sigma2);
+        llr_bpsk(y, llrs, BLOCK, amp, sigma2);
+        sink += llrs[k];
+    }
+    t = now() - t0;
+    printf("BPSK with estimator\t%.3g\n", (double)BLOCK * BLOCKS / t);
+
+    t0 = now();
+    for(k=0; k<BLOCKS; k++) {
+        llr_fsk_energies(x, fsk_bits, e_mark, e_space);
+        sink += e_mark[k % fsk_bits];
+    }
+    t = now() - t0;
+    printf("FSK tone energies\t%.3g\n", (double)fsk_samples * BLOCKS / t);
+
+    llr_fsk_noise_init(&fn, 0.1);
+    t0 = now();
+    for(k=0; k<BLOCKS; k++) {
+        llr_fsk_energies(x, fsk_bits, e_mark, e_space);
+        llr_fsk_noise_update(&fn, e_mark, e_space, fsk_bits);
+        llr_fsk_noise_get(&fn, &amp, &sigma2);
+        llr_fsk(e_mark, e_space, llrs, fsk_bits, amp, sigma2);
+        sink += llrs[k % fsk_bits];
+    }
+    t = now() - t0;
+    printf("FSK with estimator\t%.3g (%.3g bits/s)\n",
+           (double)fsk_samples * BLOCKS / t, (double)fsk_bits * BLOCKS / t);
+
+    /* Keep the timed loops from being optimised away. */
+    if(sink == 1.2345)
+        printf("\n");
+}
+
+static void bench_estimators(void)
+{
+    static float y[BLOCK];
+    const double ebn0s[] = {0.0, 3.0, 6.0, 10.0};
+    llr_bpsk_noise bn;
+    double amp, sigma2;
+    size_t i;
+    int p, k;
+
+    printf("\nBPSK estimator, %d blocks of %d\n", 16, BLOCK);
+    printf("Eb/N0\tsigma2\t\testimate\tamp est\n");
+    for(p=0; p<(int)(sizeof(ebn0s)/sizeof(ebn0s[0])); p++) {
+        double s2 = 1.0 / pow(10.0, ebn0s[p] / 10.0);
+        llr_bpsk_noise_init(&bn, 0.1);
+        for(k=0; k<16; k++) {
+            for(i=0; i<BLOCK; i++)
+                y[i] = (xorshift64s() & 1 ? -1.0 : 1.0) + sqrt(s2) * randn();
+            llr_bpsk_noise_update(&bn, y, BLOCK);
+        }
+        llr_bpsk_noise_get(&bn, &amp, &sigma2);
+        printf("%.1f\t%.4f\t\t%.4f\t\t%.4f\n", ebn0s[p], s2, sigma2, amp);
+    }
+}
+
+/* Decode FSK frames using the estimator over each frame's own bits. */
+static void bench_fsk_decode(int nframes)
+{
+    const double ebn0s[] = {3.0, 4.0, 5.0, 6.0, 7.0};
+    float x[256 * LLR_FSK_SAMPLES_PER_BIT], e_mark[256], e_space[256];
+    uint8_t data[16], coded[32], bits[256], decoded[32];
+    double llrs[256], amp, sigma2;
+    ldpc_ctx* ctx = ldpc_ctx_new();
+    llr_fsk_noise fn;
+    int p, f, i, errors;
+
+    if(ctx == NULL)
+        return;
+
+    /* Eb = L/2 for unit amplitude tones over L samples, and N0 = 2 var,
+     * so Eb/N0 = L / (4 var).
+     */
+    printf("\nFSK decode, %d frames per point\n", nframes);
+    printf("Eb/N0\tPER\t\tamp/sigma2 est\ttrue\n");
+    for(p=0; p<(int)(sizeof(ebn0s)/sizeof(ebn0s[0])); p++) {
+        double var = LLR_FSK_SAMPLES_PER_BIT
+                     / (4.0 * pow(10.0, ebn0s[p] / 10.0));
+        double ratio = 0.0;
+        errors = 0;
+        for(f=0; f<nframes; f++) {
+            for(i=0; i<16; i++)
+                data[i] = xorshift64s() & 0xFF;
+            ldpc_encode(data, coded);
+            for(i=0; i<256; i++)
+                bits[i] = (coded[i/8] >> (7 - (i % 8))) & 1;
+            fsk_modulate(bits, 256, x, sqrt(var));
+
+            llr_fsk_energies(x, 256, e_mark, e_space);
+            llr_fsk_noise_init(&fn, 1.0);
+            llr_fsk_noise_update(&fn, e_mark, e_space, 256);
+            llr_fsk_noise_get(&fn, &amp, &sigma2);
+            llr_fsk(e_mark, e_space, llrs, 256, amp, sigma2);
+            ratio += amp / sigma2;
+
+            ldpc_ctx_decode(ctx, llrs, decoded, NULL);
+            errors += memcmp(decoded, data, 16) != 0;
+        }
+
+        /* The true correlator envelope is about L/2 and each of I and Q
+         * has noise variance var L/2.
+         */
+        printf("%.1f\t%.3e\t%.4f\t\t%.4f\n", ebn0s[p],
+               (double)errors / nframes, ratio / nframes,
+               (LLR_FSK_SAMPLES_PER_BIT / 2.0)
+               / (var * LLR_FSK_SAMPLES_PER_BIT / 2.0));
+    }
+
+    ldpc_ctx_free(ctx);
+}
+
+int main(int argc, char* argv[])
+{
+    int nframes = 1000;
+
+    if(argc > 1) {
+        nframes = atoi(argv[1]);
+    }
+
+    llr_fsk_init();
+    bench_kernels();
+    bench_estimators();
+    bench_fsk_decode(nframes);
+    return 0;
+}
@@ -5,6 +5,7 @@
 #include "m2serial.h"
 #include <stdbool.h>
 #include "m2status.h"
+#include "m2crc.h"
 
 static bool recv_systemstatus(SystemStatus* status);
 
@@ -33,19 +34,7 @@ msg_t m2serial_thread(void* arg)
 
 static uint16_t compute_crc(uint8_t *buf, size_t len)
 {
-    size_t i, j;
-    uint16_t crc = 0xFFFF;
-    for(i=0; i<len; i++) {
-        crc ^= (uint16_t) buf[i] << 8;
-        for(j=0; j<8; j++) {
-            if(crc & 0x8000) {
-                crc = (crc << 1) ^ 0x1021;
-            } else {
-                crc <<= 1;
-            }
-        }
-    }
-    return crc ^ 0xFFFF;
+    return m2crc_ccitt(buf, len, 0xFFFF, 0xFFFF);
 }
 
 void m2serial_send_buffer(void* inbuf, size_t n)
@@ -1,34 +1,146 @@
 #include "m2telem.h"
+#include "m2crc.h"
+#include <stddef.h>
+#include <string.h>
 
-static uint16_t compute_crc(uint8_t *buf, size_t len)
-{
-    size_t i, j;
-    uint16_t crc = 0x0000;
-    for(i=0; i<len; i++) {
-        crc ^= (uint16_t) buf[i] << 8;
-        for(j=0; j<8; j++) {
-            if(crc & 0x8000) {
-                crc = (crc << 1) ^ 0x1021;
-            } else {
-                crc <<= 1;
-            }
-        }
-    }
-    return crc;
-}
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 void m2telem_write_checksum(TelemPacket *packet)
 {
-    uint16_t crc = compute_crc((uint8_t*)packet, 14);
+    uint16_t crc = m2crc_ccitt(packet, 14, 0x0000, 0x0000);
     packet->checksum = crc;
 }
 
 bool m2telem_check_checksum(TelemPacket *packet)
 {
-    uint16_t crc = compute_crc((uint8_t*)packet, 14);
+    uint16_t crc = m2crc_ccitt(packet, 14, 0x0000, 0x0000);
     return packet->checksum == crc;
 }
 
+#define WRAP_THRESHOLD  (168000000)
+#define WRAP_CORRECTION (0xFFFFFFFF)
+
+uint64_t m2telem_unwrap(UnwrapState* state, uint32_t ts)
+{
+    if(ts < state->last_ts && state->last_ts - ts > WRAP_THRESHOLD) {
+        state->correction += WRAP_CORRECTION;
+    }
+    state->last_ts = ts;
+    return ts + state->correction;
+}
+
+void m2telem_unwrap_scan(const uint8_t* buf, size_t n, UnwrapChunk* chunk)
+{
+    uint32_t ts, last = 0;
+    uint64_t wraps = 0;
+    size_t i;
+
+    for(i=0; i<n; i++) {
+        memcpy(&ts, &buf[16*i + offsetof(TelemPacket, timestamp)], sizeof(ts));
+        if(i == 0) {
+            chunk->first_ts = ts;
+        } else if(ts < last && last - ts > WRAP_THRESHOLD) {
+            wraps++;
+        }
+        last = ts;
+    }
+
+    chunk->n = n;
+    chunk->last_ts = last;
+    chunk->wraps = wraps;
+}
+
+uint64_t m2telem_unwrap_join(UnwrapState* state, const UnwrapChunk* chunk)
+{
+    uint64_t first;
+
+    if(chunk->n == 0) {
+        return state->correction;
+    }
+
+    m2telem_unwrap(state, chunk->first_ts);
+    first = state->correction;
+    state->correction += chunk->wraps * WRAP_CORRECTION;
+    state->last_ts = chunk->last_ts;
+    return first;
+}
+
+/* Packets checksummed at a time by the log decoders. */
+#define DECODE_BLOCK    (256)
+
+void m2telem_decode_count(const uint8_t* buf, size_t n, bool verify,
+                          size_t counts[256])
+{
+    uint16_t crcs[DECODE_BLOCK], checksum;
+    const uint8_t* p;
+    size_t i, j, m;
+
+    memset(counts, 0, 256 * sizeof(size_t));
+    for(i=0; i<n; i+=m) {
+        m = n - i < DECODE_BLOCK ? n - i : DECODE_BLOCK;
+        if(verify) {
+            m2crc_ccitt_batch(&buf[16*i], 16, 14, m, 0x0000, 0x0000, crcs);
+        }
+        for(j=0; j<m; j++) {
+            p = &buf[16*(i + j)];
+            memcpy(&checksum, p + offsetof(TelemPacket, checksum),
+                   sizeof(checksum));
+            if(!verify || checksum == crcs[j]) {
+                counts[p[offsetof(TelemPacket, channel)]]++;
+            }
+        }
+    }
+}
+
+size_t m2telem_decode_log(const uint8_t* buf, size_t n, bool verify,
+                          TelemColumns cols[256], size_t* n_bad)
+{
+    uint16_t crcs[DECODE_BLOCK];
+    UnwrapState state = {0, 0};
+    TelemColumns* col;
+    TelemPacket pkt;
+    size_t i, j, k, m, decoded = 0, bad = 0;
+    uint64_t t;
+
+    for(i=0; i<256; i++) {
+        cols[i].n = 0;
+    }
+
+    for(i=0; i<n; i+=m) {
+        m = n - i < DECODE_BLOCK ? n - i : DECODE_BLOCK;
+        if(verify) {
+            m2crc_ccitt_batch(&buf[16*i], 16, 14, m, 0x0000, 0x0000, crcs);
+        }
+        for(j=0; j<m; j++) {
+            memcpy(&pkt, &buf[16*(i + j)], sizeof(pkt));
+            t = m2telem_unwrap(&state, pkt.timestamp);
+            if(verify && pkt.checksum != crcs[j]) {
+                bad++;
+                continue;
+            }
+
+            col = &cols[pkt.channel];
+            if(col->t == NULL) {
+                continue;
+            }
+            k = col->n++;
+            col->t[k] = t;
+            memcpy(&col->values[8*k], pkt.u8, 8);
+            if(col->metadata != NULL) {
+                col->metadata[k] = pkt.metadata;
+            }
+            decoded++;
+        }
+    }
+
+    if(n_bad != NULL) {
+        *n_bad += bad;
+    }
+    return decoded;
+}
+
 void m2telem_enframe(TelemPacket* pkt, uint8_t* buf, size_t* buf_len)
 {
     int pkt_idx, buf_idx;
@@ -109,6 +221,243 @@ bool m2telem_deframe(uint8_t* buf, size_t buf_len,
     return ret;
 }
 
+/*
+ * Load 8 bytes as a uint64_t with byte k in bits 8k to 8k+7, whatever the
+ * machine's byte order.
+ */
+static inline uint64_t load_le64(const uint8_t* p)
+{
+    return  (uint64_t)p[0]        | ((uint64_t)p[1] << 8)
+         | ((uint64_t)p[2] << 16) | ((uint64_t)p[3] << 24)
+         | ((uint64_t)p[4] << 32) | ((uint64_t)p[5] << 40)
+         | ((uint64_t)p[6] << 48) | ((uint64_t)p[7] << 56);
+}
+
+/*
+ * High bit set in each byte of `x` equal to `c`. Borrows can also set the
+ * high bit of bytes above a true match, but never below one, so the lowest
+ * set bit always marks the first match.
+ */
+static inline uint64_t match_bytes(uint64_t x, uint8_t c)
+{
+    uint64_t y = x ^ (0x0101010101010101ULL * c);
+    return (y - 0x0101010101010101ULL) & ~y & 0x8080808080808080ULL;
+}
+
+/*
+ * Number of bytes before the first 0x7E or 0x7D in `buf`, looking at no
+ * more than `limit` bytes but reading up to `avail`.
+ */
+static inline size_t unescaped_run(const uint8_t* buf, size_t avail,
+                                   size_t limit)
+{
+    size_t run = 0;
+
+#if defined(__SSE2__)
+    if(avail >= 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)buf);
+        unsigned int m = _mm_movemask_epi8(
+            _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(0x7E)),
+                         _mm_cmpeq_epi8(v, _mm_set1_epi8(0x7D))));
+        run = m ? (size_t)__builtin_ctz(m) : 16;
+        return run < limit ? run : limit;
+    }
+#endif
+
+    for(; run + 8 <= avail && run < limit; run += 8) {
+        uint64_t x = load_le64(&buf[run]);
+        uint64_t m = match_bytes(x, 0x7E) | match_bytes(x, 0x7D);
+        if(m) {
+            run += __builtin_ctzll(m) / 8;
+            return run < limit ? run : limit;
+        }
+    }
+    for(; run < limit && run < avail; run++) {
+        if(buf[run] == 0x7E || buf[run] == 0x7D) {
+            break;
+        }
+    }
+    return run < limit ? run : limit;
+}
+
+size_t m2telem_deframe_many(const uint8_t* buf, size_t buf_len,
+                            DeframeState* state,
+                            TelemPacket* pkts, size_t max_pkts,
+                            bool verify, size_t* consumed, size_t* n_bad)
+{
+    size_t i = 0, n = 0, bad = 0, run;
+    const uint8_t* p;
+
+    while(i < buf_len && n < max_pkts) {
+        switch(state->s) {
+            case DEFRAME_STATE_START:
+                /* Skip straight to the next frame start. */
+                state->idx = 0;
+                p = memchr(&buf[i], 0x7E, buf_len - i);
+                if(p == NULL) {
+                    i = buf_len;
+                    continue;
+                }
+                i = p - buf + 1;
+                state->s = DEFRAME_STATE_NORMAL;
+                continue;
+
+            case DEFRAME_STATE_ESCAPED:
+                if(buf[i] == 0x7E) {
+                    state->s = DEFRAME_STATE_START;
+                    continue;
+                }
+                state->buf[state->idx++] = buf[i++] ^ 0x20;
+                state->s = DEFRAME_STATE_NORMAL;
+                break;
+
+            case DEFRAME_STATE_NORMAL:
+                /* Copy everything up to the next special byte, or the end
+                 * of the packet, in one go.
+                 */
+                run = unescaped_run(&buf[i], buf_len - i, 16 - state->idx);
+                memcpy(&state->buf[state->idx], &buf[i], run);
+                state->idx += run;
+                i += run;
+                if(state->idx < 16 && i < buf_len) {
+                    if(buf[i] == 0x7E) {
+                        state->s = DEFRAME_STATE_START;
+                        continue;
+                    }
+                    state->s = DEFRAME_STATE_ESCAPED;
+                    i++;
+                }
+                break;
+        }
+
+        if(state->idx == 16) {
+            memcpy(&pkts[n], state->buf, 16);
+            if(!verify || m2telem_check_checksum(&pkts[n])) {
+                n++;
+            } else {
+                bad++;
+            }
+            state->idx = 0;
+            state->s = DEFRAME_STATE_START;
+        }
+    }
+
+    if(consumed != NULL) {
+        *consumed = i;
+    }
+    if(n_bad != NULL) {
+        *n_bad += bad;
+    }
+    return n;
+}
+
+void m2telem_ring_init(EnframeRing* ring, uint8_t* buf, size_t size)
+{
+    ring->buf = buf;
+    ring->size = size;
+    ring->head = 0;
+    ring->tail = 0;
+}
+
+size_t m2telem_enframe_many(EnframeRing* ring, const TelemPacket* pkts,
+                            size_t n)
+{
+    const size_t mask = ring->size - 1;
+    size_t head = ring->head, i, j, len, at;
+    const uint8_t* pkt_p;
+    uint8_t* out;
+
+    for(i=0; i<n; i++) {
+        size_t space = ring->size - (head - ring->tail);
+        uint64_t lo, hi;
+
+        pkt_p = (const uint8_t*)&pkts[i];
+        lo = load_le64(pkt_p);
+        hi = load_le64(pkt_p + 8);
+        at = head & mask;
+
+        if(!(match_bytes(lo, 0x7E) | match_bytes(lo, 0x7D)
+             | match_bytes(hi, 0x7E) | match_bytes(hi, 0x7D))) {
+            /* Nothing to escape: copy the packet whole. */
+            if(space < 17) {
+                break;
+            }
+            if(ring->size - at >= 17) {
+                ring->buf[at] = 0x7E;
+                memcpy(&ring->buf[at + 1], pkt_p, 16);
+            } else {
+                ring->buf[at] = 0x7E;
+                for(j=0; j<16; j++) {
+                    ring->buf[(at + 1 + j) & mask] = pkt_p[j];
+                }
+            }
+            head += 17;
+            continue;
+        }
+
+        /* Only count the escapes when the worst case might not fit. */
+        len = 33;
+        if(space < len) {
+            len = 17;
+            for(j=0; j<16; j++) {
+                len += pkt_p[j] == 0x7E || pkt_p[j] == 0x7D;
+            }
+            if(space < len) {
+                break;
+            }
+        }
+        if(ring->size - at >= len) {
+            /* Escape straight into the ring when the frame won't wrap. */
+            out = &ring->buf[at];
+            *out++ = 0x7E;
+            for(j=0; j<16; j++) {
+                uint8_t val = pkt_p[j];
+                if(val != 0x7E && val != 0x7D) {
+                    *out++ = val;
+                } else {
+                    *out++ = 0x7D;
+                    *out++ = val ^ 0x20;
+                }
+            }
+            head += out - &ring->buf[at];
+        } else {
+            ring->buf[head++ & mask] = 0x7E;
+            for(j=0; j<16; j++) {
+                uint8_t val = pkt_p[j];
+                if(val != 0x7E && val != 0x7D) {
+                    ring->buf[head++ & mask] = val;
+                } else {
+                    ring->buf[head++ & mask] = 0x7D;
+                    ring->buf[head++ & mask] = val ^ 0x20;
+                }
+            }
+        }
+    }
+
+    /* Make sure the bytes are in memory before the consumer can see them. */
+    __sync_synchronize();
+    ring->head = head;
+    return i;
+}
+
+size_t m2telem_ring_peek(EnframeRing* ring, const uint8_t** span)
+{
+    size_t tail = ring->tail, used = ring->head - tail;
+    size_t at = tail & (ring->size - 1);
+    size_t to_end = ring->size - at;
+
+    __sync_synchronize();
+    *span = &ring->buf[at];
+    return used < to_end ? used : to_end;
+}
+
+void m2telem_ring_consume(EnframeRing* ring, size_t n)
+{
+    /* Finish reading the bytes before the producer can overwrite them. */
+    __sync_synchronize();
+    ring->tail += n;
+}
+
 const char m2telem_origin_names[16][9] = {
     "", "M2FCBODY", "M2FCNOSE", "M2R",
     "", "", "", "",
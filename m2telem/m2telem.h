@@ -40,6 +40,78 @@ typedef struct {
 void m2telem_write_checksum(TelemPacket *packet);
 bool m2telem_check_checksum(TelemPacket *packet);
 
+/* Timestamps =================================================================
+ *
+ * Packet timestamps count at 168MHz in 32 bits, wrapping about every 25.6s.
+ * Logs are unwrapped by adding 0xFFFFFFFF to every following timestamp
+ * whenever one is more than a second before the last, so the small jitter
+ * between channels is not mistaken for a wrap. The state starts zeroed.
+ */
+typedef struct {
+    uint64_t last_ts;
+    uint64_t correction;
+} UnwrapState;
+
+/* Unwrap `ts`, the next timestamp in the log, updating `state`. */
+uint64_t m2telem_unwrap(UnwrapState* state, uint32_t ts);
+
+/*
+ * For unwrapping a log in chunks in parallel. Each wrap decision depends
+ * only on the timestamp before it, so m2telem_unwrap_scan can summarise
+ * each chunk of packets independently: its first and last timestamps and
+ * how many wraps happen after its first packet. m2telem_unwrap_join then
+ * takes the chunks in order, moving `state` past each, and returns the
+ * correction for its first packet. Seeding an UnwrapState with that
+ * correction and the chunk's first timestamp unwraps the rest of the chunk
+ * exactly as one pass over the whole log would.
+ *
+ * `buf` holds `n` packets, 16 bytes each, and need not be aligned.
+ */
+typedef struct {
+    size_t n;
+    uint32_t first_ts;
+    uint32_t last_ts;
+    uint64_t wraps;
+} UnwrapChunk;
+
+void m2telem_unwrap_scan(const uint8_t* buf, size_t n, UnwrapChunk* chunk);
+uint64_t m2telem_unwrap_join(UnwrapState* state, const UnwrapChunk* chunk);
+
+/* Log decoding ===============================================================
+ *
+ * Decode a whole log, `n` packets of 16 bytes at `buf`, straight into
+ * columns per channel, for tools such as the Python wrapper m2telem.py.
+ * Every packet's timestamp is unwrapped, as m2telem_dump does, and then with
+ * `verify` packets with bad checksums are dropped.
+ *
+ * m2telem_decode_count sets `counts` to the number of packets on each
+ * channel, to size the columns, only counting packets that pass if `verify`.
+ * Checksums cost more than the rest of the decode, so callers that can spare
+ * a little memory count without verifying and decode with it, as corrupt
+ * packets are rare. m2telem_decode_log then fills the columns, setting each
+ * one's `n` to the packets written, and skips channels whose `t` is NULL.
+ * Returns the number of packets decoded and adds the number dropped to
+ * `*n_bad`, if not NULL.
+ */
+typedef struct {
+    /* Unwrapped timestamps. */
+    uint64_t* t;
+
+    /* The 8 value bytes of each packet, as logged. */
+    uint8_t* values;
+
+    /* Each packet's metadata byte, or NULL to skip. */
+    uint8_t* metadata;
+
+    /* Set to the number of packets written. */
+    size_t n;
+} TelemColumns;
+
+void m2telem_decode_count(const uint8_t* buf, size_t n, bool verify,
+                          size_t counts[256]);
+size_t m2telem_decode_log(const uint8_t* buf, size_t n, bool verify,
+                          TelemColumns cols[256], size_t* n_bad);
+
 /* Framing ====================================================================
  *
  * Frame messages by prefixing a 0x7E, then escaping any occurance of 0x7E or
@@ -55,6 +127,48 @@ bool m2telem_check_checksum(TelemPacket *packet);
  */
 void m2telem_enframe(TelemPacket* pkt, uint8_t* buf, size_t* buf_len);
 
+/*
+ * Enframe packets into a caller-owned ring buffer, for a DMA UART or file
+ * writer to send straight from.
+ *
+ * `buf` is `size` bytes, which must be a power of two. `head` and `tail`
+ * count bytes written and sent since m2telem_ring_init, so head - tail is
+ * the number waiting to be sent.
+ *
+ * One producer calling m2telem_enframe_many and one consumer calling
+ * m2telem_ring_peek and m2telem_ring_consume may run at once, for example
+ * a logging thread and a DMA complete interrupt, with no further locking.
+ */
+typedef struct {
+    uint8_t* buf;
+    size_t size;
+    volatile size_t head;
+    volatile size_t tail;
+} EnframeRing;
+
+void m2telem_ring_init(EnframeRing* ring, uint8_t* buf, size_t size);
+
+/*
+ * Enframe `n` packets from `pkts` into `ring`, stopping early at the first
+ * packet that does not fit in the free space. Returns the number of
+ * packets written.
+ *
+ * Packets with no byte needing escaping, the usual case, are copied whole
+ * after their 0x7E rather than byte by byte.
+ */
+size_t m2telem_enframe_many(EnframeRing* ring, const TelemPacket* pkts,
+                            size_t n);
+
+/*
+ * Set `*span` to the oldest unsent bytes in `ring` and return how many of
+ * them are contiguous, up to the end of the buffer. Zero when empty.
+ * Call again after consuming to get any bytes from the start of the buffer.
+ */
+size_t m2telem_ring_peek(EnframeRing* ring, const uint8_t** span);
+
+/* Mark `n` bytes from the last m2telem_ring_peek as sent. */
+void m2telem_ring_consume(EnframeRing* ring, size_t n);
+
 /*
  * Deframe a packet from a buffer that may contain fragments of packets.
  *
@@ -75,6 +189,27 @@ typedef struct {
 bool m2telem_deframe(uint8_t* buf, size_t buf_len,
                      DeframeState* state, TelemPacket* pkt);
 
+/*
+ * Deframe every packet from a buffer of any length, writing up to
+ * `max_pkts` of them into `pkts` and returning how many were written.
+ *
+ * `state` carries partial packets between calls exactly as for
+ * m2telem_deframe, and the two may be used in turn on the same stream.
+ * Rather than stepping through each byte, looks for frame starts with
+ * memchr and copies runs of unescaped bytes into the packet in blocks.
+ *
+ * If `verify` is true, packets failing their checksum are dropped and
+ * counted into `*n_bad`, which is added to rather than set.
+ *
+ * Sets `*consumed` to the number of bytes of `buf` used, which is less
+ * than `buf_len` only when `pkts` filled up; call again from there for the
+ * rest. `consumed` and `n_bad` may be NULL.
+ */
+size_t m2telem_deframe_many(const uint8_t* buf, size_t buf_len,
+                            DeframeState* state,
+                            TelemPacket* pkts, size_t max_pkts,
+                            bool verify, size_t* consumed, size_t* n_bad);
+
 /*
  * Origin constants ===========================================================
  *
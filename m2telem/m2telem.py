@@ -0,0 +1,123 @@
+"""
+Decode M2 telemetry logs into numpy arrays, one set per channel.
+
+Uses m2telem_decode_log from libm2telem.so, built with `make lib` in this
+directory, so a whole flight decodes in one pass in C with checksums checked
+and timestamps unwrapped as m2telem_dump does.
+
+    import m2telem
+    log = m2telem.load("log_00042.bin")
+    se = log["SE_T_H"]
+    plt.plot(se.t / m2telem.TICKS_PER_SECOND, se.value[:, 1])
+
+Channels are keyed by name, or by number for channels with no name. `t` is
+the unwrapped timestamp in ticks, `value` the packet values typed by the
+channel's format, one row per packet for channels with several values, and
+`metadata` the metadata bytes, whose low nibble is the origin.
+"""
+
+import os
+import mmap
+import ctypes
+import collections
+import numpy as np
+
+TICKS_PER_SECOND = 168e6
+
+Channel = collections.namedtuple("Channel", ["t", "value", "metadata"])
+
+_lib = ctypes.CDLL(os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                                "libm2telem.so"))
+
+
+class _Columns(ctypes.Structure):
+    _fields_ = [("t", ctypes.c_void_p),
+                ("values", ctypes.c_void_p),
+                ("metadata", ctypes.c_void_p),
+                ("n", ctypes.c_size_t)]
+
+
+_lib.m2telem_decode_count.argtypes = [
+    ctypes.c_void_p, ctypes.c_size_t, ctypes.c_bool,
+    ctypes.POINTER(ctypes.c_size_t)]
+_lib.m2telem_decode_count.restype = None
+_lib.m2telem_decode_log.argtypes = [
+    ctypes.c_void_p, ctypes.c_size_t, ctypes.c_bool,
+    ctypes.POINTER(_Columns), ctypes.POINTER(ctypes.c_size_t)]
+_lib.m2telem_decode_log.restype = ctypes.c_size_t
+
+CHANNEL_NAMES = [name.value.decode() for name in
+                 (ctypes.c_char * 32 * 256).in_dll(_lib,
+                                                   "m2telem_channel_names")]
+ORIGIN_NAMES = [name.value.decode() for name in
+                (ctypes.c_char * 9 * 16).in_dll(_lib, "m2telem_origin_names")]
+
+# numpy types for each m2telem_format, in enum order.
+_FORMAT_DTYPES = ["S8", "<i8", "<u8", "<i4", "<u4", "<i2", "<u2", "i1", "u1",
+                  "<f4", "<f8"]
+_channel_dtypes = [_FORMAT_DTYPES[f] for f in
+                   (ctypes.c_int * 256).in_dll(_lib,
+                                               "m2telem_channel_formats")]
+
+
+def _channel_number(channel):
+    if isinstance(channel, int):
+        return channel
+    return CHANNEL_NAMES.index(channel)
+
+
+def decode(buf, verify=True, channels=None):
+    """
+    Decode the log in `buf`, any object supporting the buffer protocol.
+
+    With `verify`, packets with bad checksums are dropped. `channels`, a list
+    of channel names or numbers, limits which channels are returned.
+    Returns a dict of Channels and the number of packets dropped.
+    """
+    data = np.frombuffer(buf, dtype=np.uint8)
+    n = len(data) // 16
+    wanted = None
+    if channels is not None:
+        wanted = set(_channel_number(c) for c in channels)
+
+    # Count without checking checksums, which is much quicker, and trim the
+    # few corrupt packets' space off afterwards.
+    counts = (ctypes.c_size_t * 256)()
+    _lib.m2telem_decode_count(data.ctypes.data, n, False, counts)
+
+    cols = (_Columns * 256)()
+    arrays = {}
+    for ch in range(256):
+        if counts[ch] == 0 or (wanted is not None and ch not in wanted):
+            continue
+        t = np.empty(counts[ch], dtype=np.uint64)
+        values = np.empty((counts[ch], 8), dtype=np.uint8)
+        metadata = np.empty(counts[ch], dtype=np.uint8)
+        cols[ch] = _Columns(t.ctypes.data, values.ctypes.data,
+                            metadata.ctypes.data, 0)
+        arrays[ch] = (t, values, metadata)
+
+    n_bad = ctypes.c_size_t(0)
+    _lib.m2telem_decode_log(data.ctypes.data, n, verify, cols,
+                            ctypes.byref(n_bad))
+
+    out = {}
+    for ch, (t, values, metadata) in arrays.items():
+        k = cols[ch].n
+        if k == 0:
+            continue
+        t, values, metadata = t[:k], values[:k], metadata[:k]
+        value = values.view(_channel_dtypes[ch])
+        if value.shape[1] == 1:
+            value = value[:, 0]
+        out[CHANNEL_NAMES[ch] or ch] = Channel(t, value, metadata)
+    return out, n_bad.value
+
+
+def load(path, verify=True, channels=None):
+    """Decode the log file at `path`, as decode(), returning just the dict."""
+    with open(path, "rb") as f:
+        if os.fstat(f.fileno()).st_size < 16:
+            return {}
+        with mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ) as m:
+            return decode(m, verify, channels)[0]
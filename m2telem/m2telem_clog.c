@@ -0,0 +1,235 @@
+#include "m2telem_clog.h"
+#include "m2crc.h"
+#include <string.h>
+
+#define CLOG_MAGIC_0    ('M')
+#define CLOG_MAGIC_1    ('Z')
+
+/* Bytes per integer in a value by format, or 0 to store it raw. */
+static const uint8_t lane_bytes[] = {
+    [M2TELEM_C] = 0, [M2TELEM_I64] = 8, [M2TELEM_U64] = 8,
+    [M2TELEM_I32] = 4, [M2TELEM_U32] = 4, [M2TELEM_I16] = 2,
+    [M2TELEM_U16] = 2, [M2TELEM_I8] = 1, [M2TELEM_U8] = 1,
+    [M2TELEM_F] = 0, [M2TELEM_D] = 0,
+};
+
+static inline uint64_t load_le(const uint8_t* p, size_t w)
+{
+    uint64_t x = 0;
+    while(w--)
+        x = (x << 8) | p[w];
+    return x;
+}
+
+static inline void store_le(uint8_t* p, size_t w, uint64_t x)
+{
+    size_t i;
+    for(i=0; i<w; i++) {
+        p[i] = x & 0xFF;
+        x >>= 8;
+    }
+}
+
+static inline size_t put_varint(uint8_t* p, uint64_t x)
+{
+    size_t i = 0;
+    while(x >= 0x80) {
+        p[i++] = (x & 0x7F) | 0x80;
+        x >>= 7;
+    }
+    p[i++] = x;
+    return i;
+}
+
+/* Read a varint from [*p, end), moving *p past it. False if it runs off the
+ * end or is too long.
+ */
+static inline bool get_varint(const uint8_t** p, const uint8_t* end,
+                              uint64_t* x)
+{
+    uint64_t v = 0;
+    unsigned int shift;
+
+    for(shift=0; shift<64 && *p < end; shift+=7) {
+        uint8_t b = *(*p)++;
+        v |= (uint64_t)(b & 0x7F) << shift;
+        if(!(b & 0x80)) {
+            *x = v;
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Zigzag the difference a - b of two `w` byte integers, wrapping at their
+ * width, so small differences either way give small numbers.
+ */
+static inline uint64_t zigzag_diff(uint64_t a, uint64_t b, size_t w)
+{
+    unsigned int shift = 64 - 8 * w;
+    int64_t d = (int64_t)((a - b) << shift) >> shift;
+    return ((uint64_t)d << 1) ^ (uint64_t)(d >> 63);
+}
+
+static inline uint64_t unzigzag(uint64_t z)
+{
+    return (z >> 1) ^ -(z & 1);
+}
+
+void m2telem_clog_start(ClogEncoder* enc, uint8_t* buf, size_t size)
+{
+    enc->buf = buf;
+    enc->size = size;
+    enc->len = M2TELEM_CLOG_HEADER;
+    enc->n = 0;
+    enc->metadata = 0;
+    enc->has_metadata = false;
+    enc->last_ts = 0;
+    memset(enc->last, 0, sizeof(enc->last));
+}
+
+bool m2telem_clog_add(ClogEncoder* enc, const TelemPacket* pkt)
+{
+    uint8_t rec[M2TELEM_CLOG_MAX_RECORD], *p = rec;
+    uint8_t* last = enc->last[pkt->channel];
+    size_t w = lane_bytes[m2telem_channel_formats[pkt->channel]];
+    uint32_t last_ts = enc->n ? enc->last_ts : pkt->timestamp;
+    bool raw;
+    size_t i;
+
+    /* The block takes its metadata from its first good packet. */
+    raw = !m2telem_check_checksum((TelemPacket*)pkt)
+          || (enc->has_metadata && pkt->metadata != enc->metadata);
+
+    *p++ = pkt->channel;
+    p += put_varint(p, zigzag_diff(pkt->timestamp, last_ts, 4) << 1 | raw);
+
+    if(raw) {
+        memcpy(p, pkt->u8, 8);
+        p += 8;
+        *p++ = pkt->metadata;
+        *p++ = pkt->checksum & 0xFF;
+        *p++ = pkt->checksum >> 8;
+    } else if(w == 0) {
+        memcpy(p, pkt->u8, 8);
+        p += 8;
+    } else {
+        for(i=0; i<8; i+=w) {
+            p += put_varint(p, zigzag_diff(load_le(&pkt->u8[i], w),
+                                           load_le(&last[i], w), w));
+        }
+    }
+
+    if(enc->len + (p - rec) > enc->size)
+        return false;
+
+    memcpy(&enc->buf[enc->len], rec, p - rec);
+    enc->len += p - rec;
+    if(!raw) {
+        memcpy(last, pkt->u8, 8);
+        enc->metadata = pkt->metadata;
+        enc->has_metadata = true;
+    }
+    if(enc->n == 0)
+        store_le(&enc->buf[8], 4, pkt->timestamp);
+    enc->last_ts = pkt->timestamp;
+    enc->n++;
+    return true;
+}
+
+void m2telem_clog_finish(ClogEncoder* enc)
+{
+    uint8_t* hdr = enc->buf;
+    uint16_t crc;
+
+    hdr[0] = CLOG_MAGIC_0;
+    hdr[1] = CLOG_MAGIC_1;
+    hdr[2] = M2TELEM_CLOG_VERSION;
+    hdr[3] = enc->metadata;
+    store_le(&hdr[4], 2, enc->n);
+    store_le(&hdr[6], 2, enc->len - M2TELEM_CLOG_HEADER);
+    if(enc->n == 0)
+        store_le(&hdr[8], 4, 0);
+
+    crc = m2crc_ccitt_update(0x0000, hdr, 12);
+    crc = m2crc_ccitt_update(crc, &hdr[M2TELEM_CLOG_HEADER],
+                             enc->len - M2TELEM_CLOG_HEADER);
+    store_le(&hdr[12], 2, crc);
+
+    memset(&enc->buf[enc->len], 0, enc->size - enc->len);
+}
+
+bool m2telem_clog_decode(const uint8_t* block, size_t size,
+                         TelemPacket* pkts, size_t* n)
+{
+    uint8_t last[256][8];
+    const uint8_t *p, *end;
+    size_t count, len, k, i, w;
+    uint32_t ts;
+    uint64_t x;
+    TelemPacket* pkt;
+
+    *n = 0;
+    if(size < M2TELEM_CLOG_HEADER || block[0] != CLOG_MAGIC_0
+       || block[1] != CLOG_MAGIC_1 || block[2] != M2TELEM_CLOG_VERSION)
+        return false;
+
+    count = load_le(&block[4], 2);
+    len = load_le(&block[6], 2);
+    if(len > size - M2TELEM_CLOG_HEADER
+       || count > M2TELEM_CLOG_MAX_PACKETS(size))
+        return false;
+    if(m2crc_ccitt_update(m2crc_ccitt_update(0x0000, block, 12),
+                          &block[M2TELEM_CLOG_HEADER], len)
+       != load_le(&block[12], 2))
+        return false;
+
+    memset(last, 0, sizeof(last));
+    ts = load_le(&block[8], 4);
+    p = &block[M2TELEM_CLOG_HEADER];
+    end = p + len;
+
+    for(k=0; k<count; k++) {
+        pkt = &pkts[k];
+        if(p == end)
+            return false;
+        pkt->channel = *p++;
+        if(!get_varint(&p, end, &x))
+            return false;
+        ts += (uint32_t)unzigzag(x >> 1);
+        pkt->timestamp = ts;
+
+        if(x & 1) {
+            if(end - p < 11)
+                return false;
+            memcpy(pkt->u8, p, 8);
+            pkt->metadata = p[8];
+            pkt->checksum = load_le(&p[9], 2);
+            p += 11;
+            continue;
+        }
+
+        w = lane_bytes[m2telem_channel_formats[pkt->channel]];
+        if(w == 0) {
+            if(end - p < 8)
+                return false;
+            memcpy(pkt->u8, p, 8);
+            p += 8;
+        } else {
+            for(i=0; i<8; i+=w) {
+                if(!get_varint(&p, end, &x))
+                    return false;
+                store_le(&pkt->u8[i], w,
+                         load_le(&last[pkt->channel][i], w) + unzigzag(x));
+            }
+        }
+        memcpy(last[pkt->channel], pkt->u8, 8);
+        pkt->metadata = block[3];
+        m2telem_write_checksum(pkt);
+    }
+
+    if(p != end)
+        return false;
+    *n = count;
+    return true;
+}
@@ -0,0 +1,94 @@
+/*
+ * M2 Telemetry compressed logs
+ *
+ * A compressed log is a run of fixed size blocks, each decodable on its own,
+ * holding the same packets as a plain log in less space. Much of a plain
+ * packet is redundant: successive timestamps differ by tens of thousands of
+ * ticks rather than billions, and successive samples on a channel by a few
+ * counts, so storing differences takes 6 to 8 bytes for most sensor packets
+ * instead of 16.
+ *
+ * Each block starts with a header, all little-endian:
+ *      0   "MZ"
+ *      2   version, M2TELEM_CLOG_VERSION
+ *      3   metadata byte shared by the block's packets
+ *      4   u16 number of records
+ *      6   u16 payload bytes following the header
+ *      8   u32 timestamp the first record's delta is from
+ *      12  u16 CRC-16-CCITT, init 0, of header bytes 0-11 then the payload
+ * and is zero padded after the payload.
+ *
+ * Each record is one packet: its channel byte, then a varint of the zigzag
+ * encoded difference from the previous record's timestamp, as a signed 32
+ * bit number, shifted up one bit. When that bottom bit is clear the packet
+ * had the block's metadata and a good checksum, and its value follows as
+ * the varint zigzag differences of each integer in it from the last packet
+ * on the same channel in the block, taken at the channel's width in
+ * m2telem_channel_formats; characters and floats are stored as their 8 raw
+ * bytes instead. When the bit is set the 8 value bytes, metadata byte and
+ * checksum follow raw, so any packet, even a corrupt one, comes back exactly
+ * as it went in. Varints are 7 bits per byte, least significant first, with
+ * the top bit set on all but the last byte.
+ *
+ * Values are taken at the widths in m2telem_channel_formats, so a log must
+ * be decoded with the same channel table it was written with.
+ */
+
+#ifndef M2_TELEM_CLOG_H
+#define M2_TELEM_CLOG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "m2telem.h"
+
+#define M2TELEM_CLOG_VERSION    (1)
+#define M2TELEM_CLOG_HEADER     (14)
+
+/* Longest record, eight 8 bit differences of two bytes each. */
+#define M2TELEM_CLOG_MAX_RECORD (22)
+
+/* Most packets a block of `size` bytes can hold, as records are at least
+ * 3 bytes long, to size decode buffers.
+ */
+#define M2TELEM_CLOG_MAX_PACKETS(size)  \
+    (((size) - M2TELEM_CLOG_HEADER) / 3)
+
+typedef struct {
+    uint8_t* buf;
+    size_t size;
+    size_t len;
+    uint16_t n;
+    uint8_t metadata;
+    bool has_metadata;
+    uint32_t last_ts;
+
+    /* Value bytes of the last packet on each channel in this block. */
+    uint8_t last[256][8];
+} ClogEncoder;
+
+/* Start a new block in `buf`, which is `size` bytes, at most 65549. */
+void m2telem_clog_start(ClogEncoder* enc, uint8_t* buf, size_t size);
+
+/* Add `pkt` to the block. Returns false, leaving the block as it was, when
+ * it does not fit; finish the block and add it to a new one.
+ */
+bool m2telem_clog_add(ClogEncoder* enc, const TelemPacket* pkt);
+
+/* Write the block's header and zero its unused space, ready to store all
+ * `size` bytes of it.
+ */
+void m2telem_clog_finish(ClogEncoder* enc);
+
+/*
+ * Decode the `size` byte block at `block` into `pkts`, which must hold
+ * M2TELEM_CLOG_MAX_PACKETS(size) packets, setting `*n` to the number of
+ * packets. Every packet gets back its original checksum.
+ *
+ * Returns false if the block is not a compressed log block of this version,
+ * fails its CRC or is malformed, and then `*n` is 0.
+ */
+bool m2telem_clog_decode(const uint8_t* block, size_t size,
+                         TelemPacket* pkts, size_t* n);
+
+#endif /* M2_TELEM_CLOG_H */
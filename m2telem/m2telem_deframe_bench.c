@@ -0,0 +1,251 @@
+/*
+ * Check m2telem_deframe_many against m2telem_deframe and time both.
+ *
+ * Builds a stream of framed packets, a few with bad checksums, many with
+ * bytes needing escapes, some cut short by the next frame, and with noise
+ * between some frames. Deframes it with m2telem_deframe in chunks small
+ * enough that it never has two packets to return, then with
+ * m2telem_deframe_many in random chunks into a random sized array, then
+ * alternating the two, and checks all three give the same packets.
+ * Finally reports MB/s and packets/s for each, on a second stream of
+ * uniformly random bytes where escapes are rarer.
+ *
+ * Usage: m2telem_deframe_bench [packets]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include "m2telem.h"
+
+static uint64_t xorshift_state = 0x2545F4914F6CDD1DULL;
+
+static uint64_t xorshift64s(void)
+{
+    xorshift_state ^= xorshift_state >> 12;
+    xorshift_state ^= xorshift_state << 25;
+    xorshift_state ^= xorshift_state >> 27;
+    return xorshift_state * 0x2545F4914F6CDD1DULL;
+}
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Random byte, with one in eight of them needing escaping if `escapes`,
+ * or uniform, as logged data mostly is.
+ */
+static bool escapes = true;
+static uint8_t random_byte(void)
+{
+    uint64_t r = xorshift64s();
+    if(escapes && (r & 7) == 0) {
+        return (r & 8) ? 0x7E : 0x7D;
+    }
+    return r >> 32;
+}
+
+/* Fill `buf` with about `n` frames, returning its length. */
+static size_t make_stream(uint8_t* buf, size_t n)
+{
+    TelemPacket pkt;
+    uint8_t frame[33];
+    size_t len = 0, flen, i, j;
+
+    for(i=0; i<n; i++) {
+        for(j=0; j<14; j++) {
+            ((uint8_t*)&pkt)[j] = random_byte();
+        }
+        m2telem_write_checksum(&pkt);
+        if(xorshift64s() % 20 == 0) {
+            pkt.checksum ^= 1;
+        }
+        m2telem_enframe(&pkt, frame, &flen);
+
+        /* Cut a few frames short, as if the next began mid-packet. */
+        if(xorshift64s() % 50 == 0) {
+            flen = 1 + xorshift64s() % (flen - 1);
+        }
+        memcpy(&buf[len], frame, flen);
+        len += flen;
+
+        /* Noise, which may itself hold a frame start. */
+        if(xorshift64s() % 10 == 0) {
+            for(j=xorshift64s() % 8; j>0; j--) {
+                buf[len++] = random_byte();
+            }
+        }
+    }
+
+    return len;
+}
+
+/* m2telem_deframe, fed at most 16 bytes at a time so that no call can
+ * complete two packets.
+ */
+static size_t deframe_bytewise(uint8_t* buf, size_t len, TelemPacket* pkts,
+                               bool random_chunks)
+{
+    DeframeState s = {.buf={0}, .idx=0, .s=0};
+    size_t i = 0, n = 0, chunk;
+
+    while(i < len) {
+        chunk = random_chunks ? 1 + xorshift64s() % 16 : 16;
+        if(chunk > len - i) {
+            chunk = len - i;
+        }
+        if(m2telem_deframe(&buf[i], chunk, &s, &pkts[n])) {
+            n++;
+        }
+        i += chunk;
+    }
+
+    return n;
+}
+
+/* m2telem_deframe_many in random chunks into random sized arrays. */
+static size_t deframe_bulk(uint8_t* buf, size_t len, TelemPacket* pkts,
+                           bool verify, size_t* n_bad)
+{
+    DeframeState s = {.buf={0}, .idx=0, .s=0};
+    size_t i = 0, n = 0, chunk, used;
+
+    while(i < len) {
+        chunk = 1 + xorshift64s() % 4096;
+        if(chunk > len - i) {
+            chunk = len - i;
+        }
+        n += m2telem_deframe_many(&buf[i], chunk, &s, &pkts[n],
+                                  1 + xorshift64s() % 8, verify,
+                                  &used, n_bad);
+        i += used;
+    }
+
+    return n;
+}
+
+/* Alternate the two deframers on one state. */
+static size_t deframe_mixed(uint8_t* buf, size_t len, TelemPacket* pkts)
+{
+    DeframeState s = {.buf={0}, .idx=0, .s=0};
+    size_t i = 0, n = 0, chunk, used;
+    bool bulk = false;
+
+    while(i < len) {
+        chunk = 1 + xorshift64s() % 16;
+        if(chunk > len - i) {
+            chunk = len - i;
+        }
+        if(bulk) {
+            n += m2telem_deframe_many(&buf[i], chunk, &s, &pkts[n], 2,
+                                      false, &used, NULL);
+            i += used;
+        } else {
+            n += m2telem_deframe(&buf[i], chunk, &s, &pkts[n]);
+            i += chunk;
+        }
+        bulk = !bulk;
+    }
+
+    return n;
+}
+
+int main(int argc, char* argv[])
+{
+    size_t npkts = 1 << 20, len, n_ref, n, n_good = 0, n_bad = 0, i;
+    uint8_t* buf;
+    TelemPacket *ref, *pkts;
+    double t0, t;
+    int r, reps = 8;
+
+    if(argc > 1) {
+        npkts = strtoul(argv[1], NULL, 0);
+    }
+
+    buf = malloc(48 * npkts);
+    ref = malloc(npkts * sizeof(TelemPacket));
+    pkts = malloc(npkts * sizeof(TelemPacket));
+    if(buf == NULL || ref == NULL || pkts == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+
+    len = make_stream(buf, npkts);
+    n_ref = deframe_bytewise(buf, len, ref, true);
+    printf("Stream of %zu bytes, %zu packets\n", len, n_ref);
+
+    n = deframe_bulk(buf, len, pkts, false, NULL);
+    printf("bulk: %s\n", n == n_ref
+           && memcmp(pkts, ref, n * sizeof(TelemPacket)) == 0
+           ? "match" : "DIFFER");
+    if(n != n_ref || memcmp(pkts, ref, n * sizeof(TelemPacket)) != 0) {
+        return 1;
+    }
+
+    n = deframe_mixed(buf, len, pkts);
+    printf("mixed: %s\n", n == n_ref
+           && memcmp(pkts, ref, n * sizeof(TelemPacket)) == 0
+           ? "match" : "DIFFER");
+    if(n != n_ref || memcmp(pkts, ref, n * sizeof(TelemPacket)) != 0) {
+        return 1;
+    }
+
+    n = deframe_bulk(buf, len, pkts, true, &n_bad);
+    for(i=0; i<n_ref; i++) {
+        if(m2telem_check_checksum(&ref[i])) {
+            memcpy(&ref[n_good++], &ref[i], sizeof(TelemPacket));
+        }
+    }
+    printf("verified: %zu good, %zu bad, %s\n", n, n_bad,
+           n == n_good && n + n_bad == n_ref
+           && memcmp(pkts, ref, n * sizeof(TelemPacket)) == 0
+           ? "match" : "DIFFER");
+    if(n != n_good || n + n_bad != n_ref
+       || memcmp(pkts, ref, n * sizeof(TelemPacket)) != 0) {
+        return 1;
+    }
+
+    escapes = false;
+    len = make_stream(buf, npkts);
+
+    printf("\nDeframer\t\t\tMB/s\tpackets/s\n");
+
+    t0 = now();
+    for(r=0; r<reps; r++) {
+        n = deframe_bytewise(buf, len, pkts, false);
+    }
+    t = now() - t0;
+    printf("m2telem_deframe, 16B chunks\t%.0f\t%.3g\n",
+           (double)len * reps / t / 1e6, (double)n * reps / t);
+
+    t0 = now();
+    for(r=0; r<reps; r++) {
+        DeframeState s = {.buf={0}, .idx=0, .s=0};
+        n = m2telem_deframe_many(buf, len, &s, pkts, npkts, false,
+                                 NULL, NULL);
+    }
+    t = now() - t0;
+    printf("m2telem_deframe_many\t\t%.0f\t%.3g\n",
+           (double)len * reps / t / 1e6, (double)n * reps / t);
+
+    t0 = now();
+    for(r=0; r<reps; r++) {
+        DeframeState s = {.buf={0}, .idx=0, .s=0};
+        n_bad = 0;
+        n = m2telem_deframe_many(buf, len, &s, pkts, npkts, true,
+                                 NULL, &n_bad);
+    }
+    t = now() - t0;
+    printf("m2telem_deframe_many, verify\t%.0f\t%.3g\n",
+           (double)len * reps / t / 1e6, (double)(n + n_bad) * reps / t);
+
+    free(buf);
+    free(ref);
+    free(pkts);
+    return 0;
+}
@@ -1,138 +1,616 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
 #include <libgen.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <pthread.h>
 #include "m2telem.h"
+#include "m2telem_index.h"
 
-int main(int argc, char** argv)
+/*
+ * The log is decoded in chunks of CHUNK_PACKETS, `threads` chunks at a
+ * time. For each round of chunks, every thread first summarises its
+ * chunk's timestamp wraps, then the main thread joins the summaries in
+ * order to find each chunk's starting time correction, then every thread
+ * formats its chunk into a buffer per output file, and finally the main
+ * thread writes the buffers out in log order. Output is the same for any
+ * number of threads and any chunk size.
+ *
+ * With -t or -C only part of the log is wanted, so the sidecar index is
+ * used to find just the blocks holding it, and each run of those blocks is
+ * decoded as above from the unwrap state at its first checkpoint. The index
+ * is built and saved on first use.
+ */
+#define CHUNK_PACKETS (1 << 18)
+
+/* Longest possible CSV line: "%f" of a huge double alone is over 300 chars. */
+#define MAX_LINE    (512)
+
+/*
+ * With -n, each channel is written as a .npy array instead of CSV, for
+ * numpy.load to map straight into memory. Each record is the unwrapped
+ * timestamp as a little endian uint64 followed by the packet's 16 bytes as
+ * logged, so records are NPY_RECORD bytes with every field aligned. The
+ * header is padded to NPY_HEADER bytes so it can be rewritten in place with
+ * the final record count once the whole log is read. Files shared by
+ * channels of different formats, such as the unnamed channels, hold each
+ * value as raw bytes.
+ */
+#define NPY_RECORD  (24)
+#define NPY_HEADER  (256)
+
+static const char* const npy_value_descr[] = {
+    [M2TELEM_C] = "'|S8'",
+    [M2TELEM_I64] = "'<i8'",
+    [M2TELEM_U64] = "'<u8'",
+    [M2TELEM_I32] = "'<i4', (2,)",
+    [M2TELEM_U32] = "'<u4', (2,)",
+    [M2TELEM_I16] = "'<i2', (4,)",
+    [M2TELEM_U16] = "'<u2', (4,)",
+    [M2TELEM_I8] = "'|i1', (8,)",
+    [M2TELEM_U8] = "'|u1', (8,)",
+    [M2TELEM_F] = "'<f4', (2,)",
+    [M2TELEM_D] = "'<f8'",
+};
+
+static bool npy = false;
+
+/* Packets outside [t_start, t_end) or on channels not wanted are skipped. */
+static uint64_t t_start = 0, t_end = UINT64_MAX;
+static bool want[256];
+
+typedef struct {
+    char* buf;
+    size_t len;
+    size_t cap;
+} OutBuf;
+
+typedef struct {
+    const uint8_t* log;
+    size_t n;
+    UnwrapChunk wraps;
+    uint64_t correction;
+    OutBuf out[256];
+} Chunk;
+
+/* Channels whose output file is shared with an earlier channel of the same
+ * name point at that channel here; unnamed channels all share one file.
+ */
+static uint8_t out_slot[256];
+
+static int threads = 1;
+static size_t chunk_packets = CHUNK_PACKETS;
+static Chunk* chunks;
+
+/* Output files, opened as each is first written, the records written to
+ * each .npy file, and each .npy file's value descriptor.
+ */
+static const char* infile_bn;
+static int outfds[256];
+static size_t records[256];
+static const char* descrs[256];
+
+static void write_all(int fd, const char* buf, size_t len)
 {
-    FILE* infile;
-    FILE* outfiles[256] = {0};
+    size_t done = 0;
+    while(done < len) {
+        ssize_t n = write(fd, buf + done, len - done);
+        if(n < 0) {
+            perror("Error writing output file");
+            exit(1);
+        }
+        done += n;
+    }
+}
 
-    char* infile_bn;
+static const char digit_pairs[201] =
+    "00010203040506070809101112131415161718192021222324252627282930313233"
+    "34353637383940414243444546474849505152535455565758596061626364656667"
+    "6869707172737475767778798081828384858687888990919293949596979899";
 
-    size_t infile_size;
-    size_t npackets;
+/* Write `v` in decimal at `p`, returning the end. */
+static char* fmt_u64(char* p, uint64_t v)
+{
+    char tmp[20];
+    char* t = tmp + sizeof(tmp);
+    size_t len;
 
-    uint64_t this_timestamp = 0;
-    uint64_t last_timestamp = 0;
-    uint64_t t_correction = 0;
-    double this_t_s;
+    while(v >= 100) {
+        t -= 2;
+        memcpy(t, &digit_pairs[2 * (v % 100)], 2);
+        v /= 100;
+    }
+    if(v >= 10) {
+        t -= 2;
+        memcpy(t, &digit_pairs[2 * v], 2);
+    } else {
+        *--t = '0' + v;
+    }
 
-    size_t i, j;
+    len = tmp + sizeof(tmp) - t;
+    memcpy(p, t, len);
+    return p + len;
+}
+
+static char* fmt_i64(char* p, int64_t v)
+{
+    if(v < 0) {
+        *p++ = '-';
+        return fmt_u64(p, -(uint64_t)v);
+    }
+    return fmt_u64(p, v);
+}
+
+/*
+ * Write `v` exactly as printf("%f") would, returning the end.
+ *
+ * Scales by 1e6 and rounds to an integer. The product is within half an ulp
+ * of the exact value, so rounding it gives printf's answer unless the exact
+ * value is very close to halfway, where printf rounds the exact binary
+ * value to even. Those cases, along with huge values and NaNs, go to
+ * snprintf.
+ */
+static char* fmt_f(char* p, double v)
+{
+    double s, whole, frac;
+    uint64_t n, f;
+
+    s = fabs(v) * 1e6;
+    if(!(s < 0x1p50)) {
+        return p + snprintf(p, MAX_LINE, "%f", v);
+    }
+
+    whole = floor(s);
+    frac = s - whole;
+    if(fabs(frac - 0.5) <= s * 0x1p-50 + 0x1p-60) {
+        return p + snprintf(p, MAX_LINE, "%f", v);
+    }
+    n = (uint64_t)whole + (frac > 0.5);
+
+    if(signbit(v)) {
+        *p++ = '-';
+    }
+    p = fmt_u64(p, n / 1000000);
+    *p++ = '.';
+    f = n % 1000000;
+    memcpy(p, &digit_pairs[2 * (f / 10000)], 2);
+    memcpy(p + 2, &digit_pairs[2 * (f / 100 % 100)], 2);
+    memcpy(p + 4, &digit_pairs[2 * (f % 100)], 2);
+    return p + 6;
+}
+
+/* Write `n` comma separated values of `vals` with formatter `fmt`. */
+#define FMT_LIST(p, fmt, vals, n) do {      \
+        int k_;                             \
+        for(k_=0; k_<(n); k_++) {           \
+            if(k_ > 0) *(p)++ = ',';        \
+            (p) = fmt((p), (vals)[k_]);     \
+        }                                   \
+    } while(0)
+
+/* Write the line for `pkt`, logged at unwrapped time `this_timestamp`, at
+ * `line`, returning the end.
+ */
+static char* format_packet(char* line, const TelemPacket* pkt,
+                           uint64_t this_timestamp)
+{
+    double this_t_s = this_timestamp / 168e6f;
+    const char* origin;
+    size_t len;
+
+    line = fmt_f(line, this_t_s);
+    *line++ = ',';
+    line = fmt_u64(line, pkt->timestamp);
+    *line++ = ',';
+    origin = m2telem_origin_names[pkt->metadata & 0x0F];
+    len = strlen(origin);
+    memcpy(line, origin, len);
+    line += len;
+    *line++ = ',';
+
+    switch(m2telem_channel_formats[pkt->channel]) {
+        case M2TELEM_C:
+            /* Raw bytes, NULs included, as "%c" would give. */
+            memcpy(line, pkt->c, 8);
+            line += 8;
+            break;
+        case M2TELEM_I64:
+            line = fmt_i64(line, pkt->i64);
+            break;
+        case M2TELEM_U64:
+            line = fmt_u64(line, pkt->u64);
+            break;
+        case M2TELEM_I32:
+            FMT_LIST(line, fmt_i64, pkt->i32, 2);
+            break;
+        case M2TELEM_U32:
+            FMT_LIST(line, fmt_u64, pkt->u32, 2);
+            break;
+        case M2TELEM_I16:
+            FMT_LIST(line, fmt_i64, pkt->i16, 4);
+            break;
+        case M2TELEM_U16:
+            FMT_LIST(line, fmt_u64, pkt->u16, 4);
+            break;
+        case M2TELEM_I8:
+            FMT_LIST(line, fmt_i64, pkt->i8, 8);
+            break;
+        case M2TELEM_U8:
+            FMT_LIST(line, fmt_u64, pkt->u8, 8);
+            break;
+        case M2TELEM_F:
+            FMT_LIST(line, fmt_f, pkt->f, 2);
+            break;
+        case M2TELEM_D:
+            line = fmt_f(line, pkt->d);
+            break;
+    }
+
+    *line++ = '\n';
+    return line;
+}
 
-    char outname[128];
-    char linebuf[256];
+/* Write the record for `pkt`, logged at unwrapped time `this_timestamp`, at
+ * `rec`, returning the end.
+ */
+static char* format_record(char* rec, const TelemPacket* pkt,
+                           uint64_t this_timestamp)
+{
+    int k;
+
+    for(k=0; k<8; k++)
+        rec[k] = this_timestamp >> (8 * k);
+    memcpy(rec + 8, pkt, sizeof(TelemPacket));
+    return rec + NPY_RECORD;
+}
+
+/* Write the .npy header for `n` records with value descriptor `descr` to the
+ * start of `fd`.
+ */
+static void write_npy_header(int fd, const char* descr, size_t n)
+{
+    char hdr[NPY_HEADER];
+    int len;
+
+    memcpy(hdr, "\x93NUMPY\x01\x00", 8);
+    hdr[8] = (NPY_HEADER - 10) & 0xFF;
+    hdr[9] = (NPY_HEADER - 10) >> 8;
+    len = snprintf(hdr + 10, NPY_HEADER - 10,
+                   "{'descr': [('t', '<u8'), ('value', %s), "
+                   "('timestamp', '<u4'), ('metadata', '|u1'), "
+                   "('channel', '|u1'), ('checksum', '<u2')], "
+                   "'fortran_order': False, 'shape': (%zu,), }",
+                   descr, n);
+    memset(hdr + 10 + len, ' ', NPY_HEADER - 11 - len);
+    hdr[NPY_HEADER - 1] = '\n';
+
+    if(pwrite(fd, hdr, NPY_HEADER, 0) != NPY_HEADER) {
+        perror("Error writing output file");
+        exit(1);
+    }
+}
 
-    int linebuf_len;
+static void* scan_chunk(void* arg)
+{
+    Chunk* chunk = arg;
+    m2telem_unwrap_scan(chunk->log, chunk->n, &chunk->wraps);
+    return NULL;
+}
 
+static void* format_chunk(void* arg)
+{
+    Chunk* chunk = arg;
+    UnwrapState state = {chunk->wraps.first_ts, chunk->correction};
     TelemPacket pkt;
+    char* (*format)(char*, const TelemPacket*, uint64_t);
+    OutBuf* out;
+    size_t i;
+
+    format = npy ? format_record : format_packet;
 
-    if(argc != 2) {
-        printf("Usage: %s <logfile>", argv[0]);
+    for(i=0; i<chunk->n; i++) {
+        uint64_t this_timestamp;
+
+        memcpy(&pkt, &chunk->log[16 * i], sizeof(TelemPacket));
+        this_timestamp = m2telem_unwrap(&state, pkt.timestamp);
+        if(!want[pkt.channel] || this_timestamp < t_start
+           || this_timestamp >= t_end)
+            continue;
+
+        out = &chunk->out[out_slot[pkt.channel]];
+        if(out->cap - out->len < MAX_LINE) {
+            out->cap = out->cap ? 2 * out->cap : 1 << 16;
+            out->buf = realloc(out->buf, out->cap);
+            if(out->buf == NULL) {
+                printf("Out of memory\n");
+                exit(1);
+            }
+        }
+        out->len = format(out->buf + out->len, &pkt, this_timestamp)
+                   - out->buf;
+    }
+
+    return NULL;
+}
+
+/* Run `fn` on each of `n` chunks, each on its own thread if more than one. */
+static void run_chunks(void* (*fn)(void*), Chunk* chunks, int n)
+{
+    pthread_t tids[n];
+    int k;
+
+    if(n == 1) {
+        fn(&chunks[0]);
+        return;
+    }
+    for(k=0; k<n; k++) {
+        if(pthread_create(&tids[k], NULL, fn, &chunks[k]) != 0) {
+            printf("Error starting thread\n");
+            exit(1);
+        }
+    }
+    for(k=0; k<n; k++) {
+        pthread_join(tids[k], NULL);
+    }
+}
+
+/* True if block `b` of `idx` holds any packets on wanted channels. */
+static bool block_wanted(const TelemIndex* idx, size_t b)
+{
+    int ch;
+
+    for(ch=0; ch<256; ch++) {
+        if(want[ch] && idx->cps[b+1].counts[ch] != idx->cps[b].counts[ch])
+            return true;
+    }
+    return false;
+}
+
+/* Decode the `n` packets at `log`, unwrapping from `state`, and write them
+ * to the output files.
+ */
+static void dump_packets(const uint8_t* log, size_t n, UnwrapState state)
+{
+    char outname[1024];
+    int nround, k;
+    size_t i, j;
+
+    for(i=0; i<n; ) {
+        /* Share out the next round of chunks. */
+        for(nround=0; nround<threads && i<n; nround++) {
+            size_t m = n - i < chunk_packets ? n - i : chunk_packets;
+            chunks[nround].log = &log[16 * i];
+            chunks[nround].n = m;
+            i += m;
+        }
+
+        run_chunks(scan_chunk, chunks, nround);
+        for(k=0; k<nround; k++) {
+            chunks[k].correction = m2telem_unwrap_join(&state,
+                                                       &chunks[k].wraps);
+        }
+        run_chunks(format_chunk, chunks, nround);
+
+        for(k=0; k<nround; k++) {
+            for(j=0; j<256; j++) {
+                OutBuf* out = &chunks[k].out[j];
+                if(out->len == 0)
+                    continue;
+                if(outfds[j] < 0) {
+                    if(snprintf(outname, sizeof(outname), "%s-%s.%s",
+                                infile_bn, m2telem_channel_names[j],
+                                npy ? "npy" : "csv")
+                       >= (int)sizeof(outname)) {
+                        printf("Log file name too long\n");
+                        exit(1);
+                    }
+                    outfds[j] = open(outname, O_WRONLY | O_CREAT | O_TRUNC,
+                                     0644);
+                    if(outfds[j] < 0) {
+                        printf("Error opening output file %s\n", outname);
+                        exit(1);
+                    }
+                    if(npy) {
+                        write_npy_header(outfds[j], descrs[j], 0);
+                        lseek(outfds[j], NPY_HEADER, SEEK_SET);
+                    }
+                }
+                write_all(outfds[j], out->buf, out->len);
+                records[j] += out->len / NPY_RECORD;
+                out->len = 0;
+            }
+        }
+    }
+}
+
+static void usage(const char* argv0)
+{
+    printf("Usage: %s [-n] [-j threads] [-c chunk packets] "
+           "[-t start:end] [-C channel]... <logfile>\n", argv0);
+}
+
+int main(int argc, char** argv)
+{
+    int infd, opt, k;
+    struct stat st;
+    const uint8_t* log = NULL;
+
+    const char* window = NULL;
+    bool chosen = false;
+    char* end;
+    double t0, t1;
+
+    TelemIndex idx;
+    char idxname[1024];
+    size_t first, last, b, run_end;
+
+    size_t infile_size;
+    size_t npackets;
+
+    size_t i, j;
+
+    for(i=0; i<256; i++)
+        want[i] = true;
+
+    while((opt = getopt(argc, argv, "j:c:nt:C:")) != -1) {
+        switch(opt) {
+            case 'j': threads = atoi(optarg); break;
+            case 'c': chunk_packets = strtoul(optarg, NULL, 0); break;
+            case 'n': npy = true; break;
+            case 't': window = optarg; break;
+            case 'C':
+                if(!chosen) {
+                    for(i=0; i<256; i++)
+                        want[i] = false;
+                    chosen = true;
+                }
+                for(i=0; i<256; i++) {
+                    if(strcmp(m2telem_channel_names[i], optarg) == 0)
+                        break;
+                }
+                if(i == 256) {
+                    printf("Unknown channel %s\n", optarg);
+                    return 1;
+                }
+                /* Every channel sharing the name, as they share a file. */
+                for(j=i; j<256; j++) {
+                    if(strcmp(m2telem_channel_names[j], optarg) == 0)
+                        want[j] = true;
+                }
+                break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+    if(threads <= 0) {
+        threads = sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    if(optind != argc - 1 || chunk_packets == 0) {
+        usage(argv[0]);
         return 1;
     }
 
-    infile = fopen(argv[1], "r");
-    if(infile == NULL) {
+    /* Seconds from the start of the log, as in the first CSV column; either
+     * end may be left out.
+     */
+    if(window != NULL) {
+        t0 = strtod(window, &end);
+        if(*end != ':' || t0 < 0.0) {
+            usage(argv[0]);
+            return 1;
+        }
+        t_start = t0 * 168e6;
+        if(end[1] != '\0') {
+            t1 = strtod(end + 1, &end);
+            if(*end != '\0' || t1 < t0) {
+                usage(argv[0]);
+                return 1;
+            }
+            t_end = t1 * 168e6;
+        }
+    }
+
+    infd = open(argv[optind], O_RDONLY);
+    if(infd < 0 || fstat(infd, &st) != 0) {
         printf("Error opening log file\n");
         return 1;
     }
 
-    infile_bn = basename(argv[1]);
+    if(snprintf(idxname, sizeof(idxname), "%s.idx", argv[optind])
+       >= (int)sizeof(idxname)) {
+        printf("Log file name too long\n");
+        return 1;
+    }
+    infile_bn = basename(argv[optind]);
 
-    fseek(infile, 0, SEEK_END);
-    infile_size = ftell(infile);
+    infile_size = st.st_size;
     npackets = infile_size / 16;
-    rewind(infile);
-
-    for(i = 0; i < npackets; i++) {
-        j = fread(&pkt, sizeof(TelemPacket), 1, infile);
-        if(j != 1) {
-            printf("Could not read a complete packet from log\n");
+    if(npackets > 0) {
+        log = mmap(NULL, infile_size, PROT_READ, MAP_PRIVATE, infd, 0);
+        if(log == MAP_FAILED) {
+            printf("Error mapping log file\n");
             return 1;
         }
-        if(pkt.timestamp < last_timestamp && last_timestamp - pkt.timestamp > 168000000) {
-            t_correction += 0xFFFFFFFF;
-        }
-        last_timestamp = pkt.timestamp;
-        this_timestamp = pkt.timestamp + t_correction;
-        this_t_s = this_timestamp / 168e6f;
+        if(window == NULL && !chosen)
+            madvise((void*)log, infile_size, MADV_SEQUENTIAL);
+    }
 
-        if(outfiles[pkt.channel] == NULL) {
-            sprintf(outname, "%s-%s.csv", infile_bn, m2telem_channel_names[pkt.channel]);
-            outfiles[pkt.channel] = fopen(outname, "w");
+    for(i=0; i<256; i++) {
+        outfds[i] = -1;
+        records[i] = 0;
+        out_slot[i] = i;
+        for(j=0; j<i; j++) {
+            if(strcmp(m2telem_channel_names[i],
+                      m2telem_channel_names[j]) == 0) {
+                out_slot[i] = j;
+                break;
+            }
         }
+        descrs[i] = npy_value_descr[m2telem_channel_formats[i]];
+        if(m2telem_channel_formats[i]
+           != m2telem_channel_formats[out_slot[i]]) {
+            descrs[out_slot[i]] = "'|V8'";
+        }
+    }
 
-        linebuf_len = sprintf(linebuf, "%f,%u,%s,", this_t_s, pkt.timestamp,
-                              m2telem_origin_names[pkt.metadata & 0x0F]);
+    chunks = calloc(threads, sizeof(Chunk));
+    if(chunks == NULL) {
+        printf("Out of memory\n");
+        return 1;
+    }
 
-        switch(m2telem_channel_formats[pkt.channel]) {
-            case M2TELEM_C:
-                linebuf_len += sprintf(
-                    linebuf+linebuf_len, "%c%c%c%c%c%c%c%c",
-                    pkt.c[0], pkt.c[1], pkt.c[2], pkt.c[3],
-                    pkt.c[4], pkt.c[5], pkt.c[6], pkt.c[7]
-                    );
-                break;
-            case M2TELEM_I64:
-                linebuf_len += sprintf(
-                    linebuf+linebuf_len, "%ld", pkt.i64);
-                break;
-            case M2TELEM_U64:
-                linebuf_len += sprintf(
-                    linebuf+linebuf_len, "%lu", pkt.u64);
-                break;
-            case M2TELEM_I32:
-                linebuf_len += sprintf(
-                    linebuf+linebuf_len, "%d,%d", pkt.i32[0], pkt.i32[1]);
-                break;
-            case M2TELEM_U32:
-                linebuf_len += sprintf(
-                    linebuf+linebuf_len, "%u,%u", pkt.u32[0], pkt.u32[1]);
-                break;
-            case M2TELEM_I16:
-                linebuf_len += sprintf(
-                    linebuf+linebuf_len, "%d,%d,%d,%d",
-                    pkt.i16[0], pkt.i16[1], pkt.i16[2], pkt.i16[3]);
-                break;
-            case M2TELEM_U16:
-                linebuf_len += sprintf(
-                    linebuf+linebuf_len, "%u,%u,%u,%u",
-                    pkt.u16[0], pkt.u16[1], pkt.u16[2], pkt.u16[3]);
-                break;
-            case M2TELEM_I8:
-                linebuf_len += sprintf(
-                    linebuf+linebuf_len, "%d,%d,%d,%d,%d,%d,%d,%d",
-                    pkt.i8[0], pkt.i8[1], pkt.i8[2], pkt.i8[3],
-                    pkt.i8[4], pkt.i8[5], pkt.i8[6], pkt.i8[7]);
-                break;
-            case M2TELEM_U8:
-                linebuf_len += sprintf(
-                    linebuf+linebuf_len, "%u,%u,%u,%u,%u,%u,%u,%u",
-                    pkt.u8[0], pkt.u8[1], pkt.u8[2], pkt.u8[3],
-                    pkt.u8[4], pkt.u8[5], pkt.u8[6], pkt.u8[7]);
-                break;
-            case M2TELEM_F:
-                linebuf_len += sprintf(
-                    linebuf+linebuf_len, "%f,%f", pkt.f[0], pkt.f[1]);
-                break;
-            case M2TELEM_D:
-                linebuf_len += sprintf(
-                    linebuf+linebuf_len, "%f", pkt.d);
-                break;
+    if(window == NULL && !chosen) {
+        UnwrapState state = {0, 0};
+        dump_packets(log, npackets, state);
+    } else {
+        if(!m2telem_index_load(&idx, idxname, infile_size)) {
+            if(!m2telem_index_build(&idx, log, infile_size, 0)) {
+                printf("Out of memory\n");
+                return 1;
+            }
+            if(!m2telem_index_save(&idx, idxname))
+                printf("Error writing index %s\n", idxname);
+        }
+
+        m2telem_index_find(&idx, t_start, t_end, &first, &last);
+        for(b=first; b<last; b=run_end) {
+            if(!block_wanted(&idx, b)) {
+                run_end = b + 1;
+                continue;
+            }
+            for(run_end=b+1; run_end<last; run_end++) {
+                if(!block_wanted(&idx, run_end))
+                    break;
+            }
+            dump_packets(&log[idx.cps[b].offset],
+                         (idx.cps[run_end].offset - idx.cps[b].offset) / 16,
+                         idx.cps[b].unwrap);
         }
 
-        linebuf_len += sprintf(linebuf+linebuf_len, "\n");
-        fwrite(linebuf, 1, linebuf_len, outfiles[pkt.channel]);
+        m2telem_index_free(&idx);
     }
 
     for(i=0; i<256; i++) {
-        if(outfiles[i] != NULL)
-            fclose(outfiles[i]);
+        if(outfds[i] >= 0) {
+            if(npy)
+                write_npy_header(outfds[i], descrs[i], records[i]);
+            close(outfds[i]);
+        }
+        for(k=0; k<threads; k++)
+            free(chunks[k].out[i].buf);
     }
+    free(chunks);
 
-    fclose(infile);
+    if(log != NULL)
+        munmap((void*)log, infile_size);
+    close(infd);
 
     return 0;
 }
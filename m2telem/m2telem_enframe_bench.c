@@ -0,0 +1,155 @@
+/*
+ * Check m2telem_enframe_many against m2telem_enframe and time both.
+ *
+ * Enframes random packets into a small ring in random sized batches,
+ * draining it through m2telem_ring_peek in random sized pieces as a DMA
+ * UART or file writer would, and checks the bytes that come out are
+ * exactly m2telem_enframe's frames one after another. Then reports MB/s of
+ * framed output for each, best of several runs, with uniformly random
+ * packets and with one byte in eight needing escaping.
+ *
+ * Usage: m2telem_enframe_bench [packets]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include "m2telem.h"
+
+#define RING_SIZE (4096)
+
+static uint64_t xorshift_state = 0x2545F4914F6CDD1DULL;
+
+static uint64_t xorshift64s(void)
+{
+    xorshift_state ^= xorshift_state >> 12;
+    xorshift_state ^= xorshift_state << 25;
+    xorshift_state ^= xorshift_state >> 27;
+    return xorshift_state * 0x2545F4914F6CDD1DULL;
+}
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void make_packets(TelemPacket* pkts, size_t n, bool escapes)
+{
+    size_t i, j;
+    for(i=0; i<n; i++) {
+        for(j=0; j<16; j++) {
+            uint64_t r = xorshift64s();
+            ((uint8_t*)&pkts[i])[j] = escapes && (r & 7) == 0
+                                      ? ((r & 8) ? 0x7E : 0x7D) : r >> 32;
+        }
+    }
+}
+
+/* One frame at a time into a scratch buffer, then copied out. */
+static size_t enframe_single(const TelemPacket* pkts, size_t n, uint8_t* out)
+{
+    size_t i, len, total = 0;
+    uint8_t frame[33];
+    for(i=0; i<n; i++) {
+        m2telem_enframe((TelemPacket*)&pkts[i], frame, &len);
+        memcpy(&out[total], frame, len);
+        total += len;
+    }
+    return total;
+}
+
+/* Through the ring, in batches of up to `batch` packets, draining up to
+ * `drain` bytes at a time, or everything if `drain` is 0.
+ */
+static size_t enframe_ring(const TelemPacket* pkts, size_t n, uint8_t* out,
+                           size_t batch, size_t drain, bool random_sizes)
+{
+    static uint8_t ring_buf[RING_SIZE];
+    EnframeRing ring;
+    const uint8_t* span;
+    size_t i = 0, total = 0, len, want;
+
+    m2telem_ring_init(&ring, ring_buf, RING_SIZE);
+    while(i < n || ring.head != ring.tail) {
+        want = random_sizes ? 1 + xorshift64s() % batch : batch;
+        if(want > n - i) {
+            want = n - i;
+        }
+        i += m2telem_enframe_many(&ring, &pkts[i], want);
+
+        len = m2telem_ring_peek(&ring, &span);
+        if(drain && random_sizes) {
+            want = xorshift64s() % drain;
+            len = len < want ? len : want;
+        }
+        memcpy(&out[total], span, len);
+        total += len;
+        m2telem_ring_consume(&ring, len);
+    }
+
+    return total;
+}
+
+int main(int argc, char* argv[])
+{
+    size_t n = 1 << 20, len_ref, len;
+    TelemPacket* pkts;
+    uint8_t *ref, *out;
+    double t0, t, best;
+    int r, reps = 8, escapes;
+
+    if(argc > 1) {
+        n = strtoul(argv[1], NULL, 0);
+    }
+
+    pkts = malloc(n * sizeof(TelemPacket));
+    ref = malloc(33 * n);
+    out = malloc(33 * n);
+    if(pkts == NULL || ref == NULL || out == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+
+    for(escapes=1; escapes>=0; escapes--) {
+        make_packets(pkts, n, escapes);
+
+        len_ref = enframe_single(pkts, n, ref);
+        len = enframe_ring(pkts, n, out, 256, 2048, true);
+        printf("%s packets: %zu bytes framed, ring %s\n",
+               escapes ? "Escape heavy" : "Uniform", len_ref,
+               len == len_ref && memcmp(out, ref, len) == 0
+               ? "matches" : "DIFFERS");
+        if(len != len_ref || memcmp(out, ref, len) != 0) {
+            return 1;
+        }
+
+        printf("Enframer\t\t\tMB/s\n");
+
+        best = 1e9;
+        for(r=0; r<reps; r++) {
+            t0 = now();
+            len = enframe_single(pkts, n, out);
+            t = now() - t0;
+            best = t < best ? t : best;
+        }
+        printf("m2telem_enframe\t\t\t%.0f\n", len / best / 1e6);
+
+        best = 1e9;
+        for(r=0; r<reps; r++) {
+            t0 = now();
+            len = enframe_ring(pkts, n, out, 64, 0, false);
+            t = now() - t0;
+            best = t < best ? t : best;
+        }
+        printf("m2telem_enframe_many\t\t%.0f\n\n", len / best / 1e6);
+    }
+
+    free(pkts);
+    free(ref);
+    free(out);
+    return 0;
+}
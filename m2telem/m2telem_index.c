@@ -0,0 +1,201 @@
+#include "m2telem_index.h"
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define INDEX_MAGIC     "M2TI"
+#define INDEX_VERSION   (1)
+
+/* Sidecar file header, followed by `n` TelemCheckpoints. */
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t interval;
+    uint32_t checkpoint_size;
+    uint64_t log_size;
+    uint64_t n;
+} IndexHeader;
+
+bool m2telem_index_build(TelemIndex* idx, const uint8_t* log, size_t len,
+                         uint32_t interval)
+{
+    size_t npackets = len / 16, nblocks, i, k;
+    TelemCheckpoint* cps;
+    UnwrapState state = {0, 0};
+    uint32_t counts[256] = {0};
+    uint64_t t_hi = 0, t;
+    TelemPacket pkt;
+
+    if(interval == 0)
+        interval = M2TELEM_INDEX_INTERVAL;
+    nblocks = (npackets + interval - 1) / interval;
+
+    cps = malloc((nblocks + 1) * sizeof(TelemCheckpoint));
+    if(cps == NULL)
+        return false;
+
+    for(k=0; k<=nblocks; k++) {
+        size_t start = k * interval;
+        size_t end = start + interval < npackets ? start + interval
+                                                 : npackets;
+        uint64_t t_lo = UINT64_MAX;
+
+        cps[k].offset = 16 * (k < nblocks ? start : npackets);
+        cps[k].unwrap = state;
+        memcpy(cps[k].counts, counts, sizeof(counts));
+
+        for(i=start; i<end; i++) {
+            memcpy(&pkt, &log[16 * i], sizeof(pkt));
+            t = m2telem_unwrap(&state, pkt.timestamp);
+            counts[pkt.channel]++;
+            if(t < t_lo)
+                t_lo = t;
+            if(t > t_hi)
+                t_hi = t;
+        }
+
+        /* Only this block's earliest time so far; made a suffix minimum
+         * below.
+         */
+        cps[k].t_lo = t_lo;
+        cps[k].t_hi = t_hi;
+    }
+
+    for(k=nblocks; k>0; k--) {
+        if(cps[k].t_lo < cps[k-1].t_lo)
+            cps[k-1].t_lo = cps[k].t_lo;
+    }
+
+    idx->interval = interval;
+    idx->log_size = len;
+    idx->n = nblocks + 1;
+    idx->cps = cps;
+    idx->map = NULL;
+    idx->map_len = 0;
+    return true;
+}
+
+bool m2telem_index_save(const TelemIndex* idx, const char* path)
+{
+    IndexHeader hdr;
+    FILE* f;
+    bool ok;
+
+    memcpy(hdr.magic, INDEX_MAGIC, 4);
+    hdr.version = INDEX_VERSION;
+    hdr.interval = idx->interval;
+    hdr.checkpoint_size = sizeof(TelemCheckpoint);
+    hdr.log_size = idx->log_size;
+    hdr.n = idx->n;
+
+    f = fopen(path, "wb");
+    if(f == NULL)
+        return false;
+    ok = fwrite(&hdr, sizeof(hdr), 1, f) == 1
+         && fwrite(idx->cps, sizeof(TelemCheckpoint), idx->n, f) == idx->n;
+    ok = fclose(f) == 0 && ok;
+    if(!ok)
+        remove(path);
+    return ok;
+}
+
+bool m2telem_index_load(TelemIndex* idx, const char* path, uint64_t log_size)
+{
+    IndexHeader hdr;
+    struct stat st;
+    void* map;
+    int fd;
+
+    fd = open(path, O_RDONLY);
+    if(fd < 0)
+        return false;
+    if(fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(hdr)) {
+        close(fd);
+        return false;
+    }
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(map == MAP_FAILED)
+        return false;
+
+    memcpy(&hdr, map, sizeof(hdr));
+    if(memcmp(hdr.magic, INDEX_MAGIC, 4) != 0
+       || hdr.version != INDEX_VERSION
+       || hdr.checkpoint_size != sizeof(TelemCheckpoint)
+       || hdr.log_size != log_size || hdr.n == 0
+       || (uint64_t)st.st_size != sizeof(hdr)
+                                  + hdr.n * sizeof(TelemCheckpoint)) {
+        munmap(map, st.st_size);
+        return false;
+    }
+
+    idx->interval = hdr.interval;
+    idx->log_size = hdr.log_size;
+    idx->n = hdr.n;
+    idx->cps = (const TelemCheckpoint*)((const uint8_t*)map + sizeof(hdr));
+    idx->map = map;
+    idx->map_len = st.st_size;
+    return true;
+}
+
+void m2telem_index_free(TelemIndex* idx)
+{
+    if(idx->map != NULL)
+        munmap(idx->map, idx->map_len);
+    else
+        free((void*)idx->cps);
+    idx->cps = NULL;
+    idx->map = NULL;
+    idx->n = 0;
+}
+
+void m2telem_index_find(const TelemIndex* idx, uint64_t t0, uint64_t t1,
+                        size_t* first, size_t* last)
+{
+    size_t lo, hi, mid;
+
+    /* First block whose t_hi reaches t0. */
+    lo = 0;
+    hi = idx->n - 1;
+    while(lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if(idx->cps[mid].t_hi >= t0)
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+    *first = lo;
+
+    /* First checkpoint after which nothing is before t1. The end of the
+     * log always qualifies, its t_lo being UINT64_MAX.
+     */
+    lo = 0;
+    hi = idx->n - 1;
+    while(lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if(idx->cps[mid].t_lo >= t1)
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+    *last = lo > *first ? lo : *first;
+}
+
+size_t m2telem_index_find_nth(const TelemIndex* idx, uint8_t channel,
+                              uint32_t nth)
+{
+    size_t lo = 0, hi = idx->n - 1, mid;
+
+    /* First checkpoint with more than `nth` packets before it, less one. */
+    while(lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if(idx->cps[mid + 1].counts[channel] > nth)
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+    return lo;
+}
@@ -0,0 +1,83 @@
+/*
+ * M2 Telemetry log index
+ *
+ * Times in a log are only known by unwrapping every timestamp from the start,
+ * so finding one moment in a long log means reading all of it. An index
+ * records a checkpoint every `interval` packets with enough state to start
+ * decoding there, and is kept as a sidecar file next to the log so it is only
+ * built once. Host tools only; the index is in host byte order.
+ */
+
+#ifndef M2_TELEM_INDEX_H
+#define M2_TELEM_INDEX_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "m2telem.h"
+
+/* Packets between checkpoints by default, 128KB of log. */
+#define M2TELEM_INDEX_INTERVAL  (8192)
+
+/*
+ * Checkpoint k starts block k, which runs up to checkpoint k+1. The final
+ * checkpoint is at the end of the log and starts no block.
+ *
+ * Unwrapped times are not quite in order, as corrupt packets carry any
+ * timestamp, so each checkpoint keeps two bounds that are: t_lo is the
+ * earliest time of any packet from the checkpoint to the end of the log,
+ * and t_hi the latest time of any packet up to the end of its block.
+ */
+typedef struct {
+    /* Byte offset of the checkpoint's first packet. */
+    uint64_t offset;
+
+    uint64_t t_lo;
+    uint64_t t_hi;
+
+    /* State to seed m2telem_unwrap with to decode from `offset`. */
+    UnwrapState unwrap;
+
+    /* Packets on each channel before `offset`. */
+    uint32_t counts[256];
+} TelemCheckpoint;
+
+typedef struct {
+    uint32_t interval;
+    uint64_t log_size;
+    size_t n;
+    const TelemCheckpoint* cps;
+
+    /* Set when `cps` is mapped from a sidecar file rather than allocated. */
+    void* map;
+    size_t map_len;
+} TelemIndex;
+
+/* Index the `len` byte log at `log`, with a checkpoint every `interval`
+ * packets. Returns false if out of memory.
+ */
+bool m2telem_index_build(TelemIndex* idx, const uint8_t* log, size_t len,
+                         uint32_t interval);
+
+/* Write the index to `path`, or map it from `path`. Loading fails if the
+ * file is not an index or was built for a log of other than `log_size`
+ * bytes, since logs only ever grow.
+ */
+bool m2telem_index_save(const TelemIndex* idx, const char* path);
+bool m2telem_index_load(TelemIndex* idx, const char* path, uint64_t log_size);
+
+void m2telem_index_free(TelemIndex* idx);
+
+/* Find the blocks [*first, *last) holding every packet with unwrapped time
+ * in [t0, t1). They may hold other packets too.
+ */
+void m2telem_index_find(const TelemIndex* idx, uint64_t t0, uint64_t t1,
+                        size_t* first, size_t* last);
+
+/* Find the block holding packet `nth`, counting from 0, on `channel`, or
+ * idx->n - 1 if there are not that many.
+ */
+size_t m2telem_index_find_nth(const TelemIndex* idx, uint8_t channel,
+                              uint32_t nth);
+
+#endif /* M2_TELEM_INDEX_H */
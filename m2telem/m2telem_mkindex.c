@@ -0,0 +1,120 @@
+/*
+ * Build the sidecar index for a log, as m2telem_dump does on first use, and
+ * time a range query against it.
+ *
+ * Usage: m2telem_mkindex [-i interval] <logfile> [start:end]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "m2telem.h"
+#include "m2telem_index.h"
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char* argv[])
+{
+    int fd, opt;
+    struct stat st;
+    const uint8_t* log = NULL;
+    uint32_t interval = M2TELEM_INDEX_INTERVAL;
+    TelemIndex idx;
+    char idxname[1024];
+    double t0, t1, start;
+    size_t first, last, i, n = 0;
+    uint64_t ts_start, ts_end;
+
+    while((opt = getopt(argc, argv, "i:")) != -1) {
+        switch(opt) {
+            case 'i': interval = strtoul(optarg, NULL, 0); break;
+            default:
+                printf("Usage: %s [-i interval] <logfile> [start:end]\n",
+                       argv[0]);
+                return 1;
+        }
+    }
+    if(optind != argc - 1 && optind != argc - 2) {
+        printf("Usage: %s [-i interval] <logfile> [start:end]\n", argv[0]);
+        return 1;
+    }
+
+    fd = open(argv[optind], O_RDONLY);
+    if(fd < 0 || fstat(fd, &st) != 0) {
+        printf("Error opening log file\n");
+        return 1;
+    }
+    if(st.st_size >= 16) {
+        log = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(log == MAP_FAILED) {
+            printf("Error mapping log file\n");
+            return 1;
+        }
+    }
+    if(snprintf(idxname, sizeof(idxname), "%s.idx", argv[optind])
+       >= (int)sizeof(idxname)) {
+        printf("Log file name too long\n");
+        return 1;
+    }
+
+    start = now();
+    if(!m2telem_index_build(&idx, log, st.st_size, interval)) {
+        printf("Out of memory\n");
+        return 1;
+    }
+    if(!m2telem_index_save(&idx, idxname)) {
+        printf("Error writing index %s\n", idxname);
+        return 1;
+    }
+    printf("Indexed %zu packets in %zu blocks in %.3fs\n",
+           (size_t)st.st_size / 16, idx.n - 1, now() - start);
+    m2telem_index_free(&idx);
+
+    if(optind == argc - 2) {
+        if(sscanf(argv[optind + 1], "%lf:%lf", &t0, &t1) != 2) {
+            printf("Bad range %s\n", argv[optind + 1]);
+            return 1;
+        }
+        ts_start = t0 * 168e6;
+        ts_end = t1 * 168e6;
+
+        /* From a cold start, as a tool would: map the index, find the
+         * blocks and unwrap through them.
+         */
+        start = now();
+        if(!m2telem_index_load(&idx, idxname, st.st_size)) {
+            printf("Error loading index %s\n", idxname);
+            return 1;
+        }
+        m2telem_index_find(&idx, ts_start, ts_end, &first, &last);
+        if(first < last) {
+            UnwrapState state = idx.cps[first].unwrap;
+            TelemPacket pkt;
+            for(i=idx.cps[first].offset; i<idx.cps[last].offset; i+=16) {
+                uint64_t t;
+                memcpy(&pkt, &log[i], sizeof(pkt));
+                t = m2telem_unwrap(&state, pkt.timestamp);
+                n += t >= ts_start && t < ts_end;
+            }
+        }
+        printf("%zu packets in %.3f-%.3fs, from %zu blocks, in %.3fms\n",
+               n, t0, t1, last - first, (now() - start) * 1e3);
+        m2telem_index_free(&idx);
+    }
+
+    if(log != NULL)
+        munmap((void*)log, st.st_size);
+    close(fd);
+    return 0;
+}
@@ -0,0 +1,215 @@
+/*
+ * Compress a plain log into the compressed log format of m2telem_clog.h, or
+ * unpack a compressed log from the card back into a plain one.
+ *
+ * Packing is mostly for measuring the format against existing flight logs:
+ * every block written is decoded again and checked against the packets that
+ * went in, and the compression ratio is reported, overall and per channel.
+ * Unpacking skips, and reports, any block that fails its CRC, such as a
+ * block left half written by a failed card write or never written at all.
+ * Either way the output is a plain log for all the other tools.
+ *
+ * Blocks are CACHE_BLOCK bytes by default, as M2FC writes them.
+ *
+ * Usage: m2telem_pack [-d] [-b block size] <in> <out>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "m2telem.h"
+#include "m2telem_clog.h"
+
+/* LOG_CACHE_SIZE in m2fc/firmware/datalogging.c. */
+#define CACHE_BLOCK     (16384)
+
+static ClogEncoder enc;
+static size_t block_size = CACHE_BLOCK;
+
+static void write_block(FILE* f, const void* buf, size_t len)
+{
+    if(fwrite(buf, 1, len, f) != len) {
+        printf("Error writing output file\n");
+        exit(1);
+    }
+}
+
+/* Finish the block in `block`, holding the `n` packets at `pkts`, check it
+ * decodes back to them, and write it out.
+ */
+static void flush_block(FILE* out, uint8_t* block, const TelemPacket* pkts,
+                        size_t n, TelemPacket* check)
+{
+    size_t n_check;
+
+    m2telem_clog_finish(&enc);
+    if(!m2telem_clog_decode(block, block_size, check, &n_check)
+       || n_check != n || memcmp(check, pkts, n * sizeof(TelemPacket))) {
+        printf("Block %zu does not decode to its packets\n",
+               (size_t)(ftell(out) / block_size));
+        exit(1);
+    }
+    write_block(out, block, block_size);
+}
+
+static void pack(const uint8_t* log, size_t len, FILE* out)
+{
+    size_t npackets = len / 16, i, start = 0, blocks = 0, bytes;
+    size_t counts[256] = {0}, sizes[256] = {0}, ch;
+    size_t other_count = 0, other_size = 0;
+    uint8_t* block = malloc(block_size);
+    TelemPacket* check = malloc(M2TELEM_CLOG_MAX_PACKETS(block_size)
+                                * sizeof(TelemPacket));
+    TelemPacket pkt;
+
+    if(block == NULL || check == NULL) {
+        printf("Out of memory\n");
+        exit(1);
+    }
+
+    m2telem_clog_start(&enc, block, block_size);
+    for(i=0; i<npackets; i++) {
+        memcpy(&pkt, &log[16 * i], 16);
+        bytes = enc.len;
+        if(!m2telem_clog_add(&enc, &pkt)) {
+            flush_block(out, block, (const TelemPacket*)&log[16 * start],
+                        i - start, check);
+            blocks++;
+            start = i;
+            m2telem_clog_start(&enc, block, block_size);
+            bytes = enc.len;
+            m2telem_clog_add(&enc, &pkt);
+        }
+        counts[pkt.channel]++;
+        sizes[pkt.channel] += enc.len - bytes;
+    }
+    if(i > start) {
+        flush_block(out, block, (const TelemPacket*)&log[16 * start],
+                    i - start, check);
+        blocks++;
+    }
+    if(len % 16)
+        printf("Ignoring %zu bytes of partial packet at end\n", len % 16);
+
+    printf("Packed %zu packets into %zu blocks, %zu bytes to %zu: "
+           "%.2f:1, %.2f bytes per packet\n",
+           npackets, blocks, 16 * npackets, blocks * block_size,
+           blocks ? 16.0 * npackets / (blocks * block_size) : 0.0,
+           npackets ? (double)(blocks * block_size) / npackets : 0.0);
+    printf("%-20s %10s %12s %8s\n", "Channel", "Packets", "Bytes/packet",
+           "Ratio");
+    for(ch=0; ch<256; ch++) {
+        if(counts[ch] == 0)
+            continue;
+        if(!m2telem_channel_names[ch][0]) {
+            other_count += counts[ch];
+            other_size += sizes[ch];
+            continue;
+        }
+        printf("%-20s %10zu %12.2f %7.2f:1\n", m2telem_channel_names[ch],
+               counts[ch], (double)sizes[ch] / counts[ch],
+               16.0 * counts[ch] / sizes[ch]);
+    }
+    if(other_count)
+        printf("%-20s %10zu %12.2f %7.2f:1\n", "(unnamed)", other_count,
+               (double)other_size / other_count,
+               16.0 * other_count / other_size);
+
+    free(block);
+    free(check);
+}
+
+static void unpack(const uint8_t* log, size_t len, FILE* out)
+{
+    size_t nblocks = len / block_size, b, n, npackets = 0, bad = 0;
+    TelemPacket* pkts = malloc(M2TELEM_CLOG_MAX_PACKETS(block_size)
+                               * sizeof(TelemPacket));
+
+    if(pkts == NULL) {
+        printf("Out of memory\n");
+        exit(1);
+    }
+
+    for(b=0; b<nblocks; b++) {
+        if(!m2telem_clog_decode(&log[b * block_size], block_size, pkts, &n)) {
+            printf("Bad block %zu at offset %zu\n", b, b * block_size);
+            bad++;
+            continue;
+        }
+        write_block(out, pkts, n * sizeof(TelemPacket));
+        npackets += n;
+    }
+    if(len % block_size)
+        printf("Ignoring %zu bytes of partial block at end\n",
+               len % block_size);
+
+    printf("Unpacked %zu packets from %zu blocks, %zu bad\n",
+           npackets, nblocks - bad, bad);
+    free(pkts);
+}
+
+int main(int argc, char* argv[])
+{
+    int fd, opt;
+    bool unpacking = false;
+    struct stat st;
+    const uint8_t* log = NULL;
+    FILE* out;
+
+    while((opt = getopt(argc, argv, "db:")) != -1) {
+        switch(opt) {
+            case 'd': unpacking = true; break;
+            case 'b': block_size = strtoul(optarg, NULL, 0); break;
+            default:
+                printf("Usage: %s [-d] [-b block size] <in> <out>\n",
+                       argv[0]);
+                return 1;
+        }
+    }
+    if(optind != argc - 2) {
+        printf("Usage: %s [-d] [-b block size] <in> <out>\n", argv[0]);
+        return 1;
+    }
+    if(block_size < M2TELEM_CLOG_HEADER + M2TELEM_CLOG_MAX_RECORD
+       || block_size > M2TELEM_CLOG_HEADER + 65535) {
+        printf("Block size must be from %d to %d bytes\n",
+               M2TELEM_CLOG_HEADER + M2TELEM_CLOG_MAX_RECORD,
+               M2TELEM_CLOG_HEADER + 65535);
+        return 1;
+    }
+
+    fd = open(argv[optind], O_RDONLY);
+    if(fd < 0 || fstat(fd, &st) != 0) {
+        printf("Error opening input file\n");
+        return 1;
+    }
+    if(st.st_size > 0) {
+        log = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(log == MAP_FAILED) {
+            printf("Error mapping input file\n");
+            return 1;
+        }
+    }
+    out = fopen(argv[optind + 1], "wb");
+    if(out == NULL) {
+        printf("Error opening output file\n");
+        return 1;
+    }
+
+    if(unpacking)
+        unpack(log, st.st_size, out);
+    else
+        pack(log, st.st_size, out);
+
+    if(fclose(out) != 0) {
+        printf("Error writing output file\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,130 @@
+/*
+ * Write a synthetic flight log for testing and timing the log tools.
+ *
+ * Packets cycle through the channels M2FC logs, at rates and with values
+ * roughly like a real flight, with timestamps counting at 168MHz so they
+ * wrap every 25.6s. A small fraction are corrupt, with random channels,
+ * values and checksums, as on a card that was written to mid power cut.
+ *
+ * Usage: m2telem_synth <logfile> [packets] [seed]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include "m2telem.h"
+
+static uint64_t xorshift_state = 0x2545F4914F6CDD1DULL;
+
+static uint64_t xorshift64s(void)
+{
+    xorshift_state ^= xorshift_state >> 12;
+    xorshift_state ^= xorshift_state << 25;
+    xorshift_state ^= xorshift_state >> 27;
+    return xorshift_state * 0x2545F4914F6CDD1DULL;
+}
+
+/* Uniform on [-1, 1). */
+static double randu(void)
+{
+    return (xorshift64s() >> 11) * (2.0 / 9007199254740992.0) - 1.0;
+}
+
+int main(int argc, char* argv[])
+{
+    static const uint8_t channels[] = {
+        M2T_CH_IMU_LG_ACCEL, M2T_CH_IMU_HG_ACCEL, M2T_CH_IMU_GYRO,
+        M2T_CH_IMU_LG_ACCEL, M2T_CH_IMU_HG_ACCEL, M2T_CH_IMU_GYRO,
+        M2T_CH_IMU_BARO, M2T_CH_IMU_MAGNO, M2T_CH_SE_T_H, M2T_CH_SE_V_A,
+        M2T_CH_SE_PRESSURE, M2T_CH_SE_ACCEL, M2T_CH_ADC_BATT,
+        M2T_CH_ADC_STRAIN, M2T_CH_ADC_THERMO, M2T_CH_STATE_MISSION,
+        M2T_CH_PYRO_CONT, M2T_CH_GPS_TIME, M2T_CH_GPS_POS, M2T_CH_GPS_ALT,
+        M2T_CH_GPS_STATUS, M2T_CH_SYS_STATS, M2T_CH_SYS_VERSION,
+        M2T_CH_CAL_TFREQ
+    };
+    const size_t nch = sizeof(channels);
+    FILE* f;
+    TelemPacket pkt;
+    size_t n = 10000000, i;
+    uint32_t t = 0;
+    int k;
+
+    if(argc < 2) {
+        fprintf(stderr, "Usage: %s <logfile> [packets] [seed]\n", argv[0]);
+        return 1;
+    }
+    if(argc > 2) {
+        n = strtoul(argv[2], NULL, 0);
+    }
+    if(argc > 3) {
+        xorshift_state = strtoull(argv[3], NULL, 0) | 1;
+    }
+
+    f = fopen(argv[1], "wb");
+    if(f == NULL) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    for(i=0; i<n; i++) {
+        /* About 6000 packets/s, with some jitter. */
+        t += 28000 + (xorshift64s() % 1000);
+        memset(&pkt, 0, sizeof(pkt));
+        pkt.timestamp = t;
+        pkt.metadata = M2T_ORIGIN_M2FCBODY;
+        pkt.channel = channels[i % nch];
+
+        switch(m2telem_channel_formats[pkt.channel]) {
+            case M2TELEM_C:
+                memcpy(pkt.c, "v1.2\0\0\0", 8);
+                break;
+            case M2TELEM_I32:
+                for(k=0; k<2; k++)
+                    pkt.i32[k] = (int32_t)(xorshift64s() >> 32) / 1000;
+                break;
+            case M2TELEM_U32:
+                pkt.u32[0] = 168000000;
+                pkt.u32[1] = xorshift64s();
+                break;
+            case M2TELEM_I16:
+                for(k=0; k<4; k++)
+                    pkt.i16[k] = (int16_t)(xorshift64s() >> 48);
+                break;
+            case M2TELEM_I8:
+            case M2TELEM_U8:
+                pkt.u64 = xorshift64s();
+                break;
+            case M2TELEM_F:
+                /* Mostly smooth values, and now and then one exactly
+                 * halfway between two 6 digit decimals.
+                 */
+                for(k=0; k<2; k++) {
+                    if(xorshift64s() % 64 == 0)
+                        pkt.f[k] = (float)(2*(xorshift64s() % 65536) + 1)
+                                   / 128.0f;
+                    else
+                        pkt.f[k] = 3000.0 * sin(i * 1e-6 + k) + randu();
+                }
+                break;
+            default:
+                pkt.u64 = xorshift64s();
+                break;
+        }
+
+        if(xorshift64s() % 1000 == 0) {
+            pkt.u64 = xorshift64s();
+            pkt.metadata = xorshift64s();
+            pkt.channel = xorshift64s();
+            pkt.checksum = xorshift64s();
+        } else {
+            m2telem_write_checksum(&pkt);
+        }
+
+        fwrite(&pkt, sizeof(pkt), 1, f);
+    }
+
+    fclose(f);
+    return 0;
+}
@@ -0,0 +1,402 @@
+/*
+ * Check every packet's checksum in a log, writing the good packets to a
+ * clean log and reporting the bad regions between them.
+ *
+ * M2FC's datalogging_thread writes the log in cache blocks of CACHE_BLOCK
+ * bytes. A failed write can leave part of a block behind, or a card can lose
+ * whole blocks, and a partial block that is not a whole number of packets
+ * misaligns everything after it. So at a bad packet the verifier searches
+ * byte by byte for the next RESYNC packets in a row with good checksums and
+ * carries on from there, and describes each bad region in terms of the
+ * blocks it covers.
+ *
+ * All-zero packets have a good checksum, CRC-16-CCITT with initial value 0
+ * being 0 over zeros, but are what unwritten card sectors read back as, so
+ * they count as bad.
+ *
+ * The log is verified in chunks of CHUNK_BLOCKS cache blocks, `threads`
+ * chunks at a time. Deciding where the next packet starts depends only on
+ * the current offset, so each chunk is verified independently, and a chunk
+ * whose start the previous chunk did not land on exactly, because it ran on
+ * past its end or landed mid-packet, is verified again from where it did.
+ * The results are the same for any number of threads.
+ *
+ * Usage: m2telem_verify [-j threads] [-c chunk blocks] [-o clean log]
+ *                       <logfile>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <libgen.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <pthread.h>
+#include "m2telem.h"
+#include "m2crc.h"
+
+/* LOG_CACHE_SIZE in m2fc/firmware/datalogging.c. */
+#define CACHE_BLOCK     (16384)
+#define CHUNK_BLOCKS    (64)
+
+/* Good packets in a row needed to resync after a bad one. Random bytes pass
+ * a 16 bit checksum one time in 65536, so four in a row are ample.
+ */
+#define RESYNC          (4)
+
+/* Packets checksummed at a time. */
+#define BATCH           (256)
+
+/* A run of bytes that are all good packets, or all bad. */
+typedef struct {
+    uint64_t offset;
+    uint64_t len;
+    bool good;
+} Run;
+
+typedef struct {
+    /* Runs starting in [start, end) are this chunk's. */
+    uint64_t start, end;
+
+    /* Where the chunk's last run finished, at or past `end`. */
+    uint64_t stop;
+
+    Run* runs;
+    size_t n_runs, cap;
+} Chunk;
+
+static const uint8_t* log_buf;
+static uint64_t log_len;
+
+static void write_all(int fd, const void* buf, size_t len)
+{
+    size_t done = 0;
+    while(done < len) {
+        ssize_t n = write(fd, (const char*)buf + done, len - done);
+        if(n < 0) {
+            perror("Error writing clean log");
+            exit(1);
+        }
+        done += n;
+    }
+}
+
+static bool packet_ok(const uint8_t* p, uint16_t crc)
+{
+    static const uint8_t zeros[16] = {0};
+    uint16_t checksum;
+
+    memcpy(&checksum, p + 14, sizeof(checksum));
+    return checksum == crc && memcmp(p, zeros, 16) != 0;
+}
+
+/* True if `n` packets in a row from `offset` are all good. */
+static bool run_ok(uint64_t offset, size_t n)
+{
+    size_t i;
+
+    for(i=0; i<n; i++) {
+        const uint8_t* p = &log_buf[offset + 16*i];
+        if(!packet_ok(p, m2crc_ccitt(p, 14, 0x0000, 0x0000)))
+            return false;
+    }
+    return true;
+}
+
+static void add_run(Chunk* chunk, uint64_t offset, uint64_t len, bool good)
+{
+    Run* last = chunk->n_runs ? &chunk->runs[chunk->n_runs - 1] : NULL;
+
+    if(good && last != NULL && last->good
+       && last->offset + last->len == offset) {
+        last->len += len;
+        return;
+    }
+    if(chunk->n_runs == chunk->cap) {
+        chunk->cap = chunk->cap ? 2 * chunk->cap : 64;
+        chunk->runs = realloc(chunk->runs, chunk->cap * sizeof(Run));
+        if(chunk->runs == NULL) {
+            printf("Out of memory\n");
+            exit(1);
+        }
+    }
+    chunk->runs[chunk->n_runs++] = (Run){offset, len, good};
+}
+
+/* Verify runs starting from `pos` up to the chunk's end. */
+static void verify_from(Chunk* chunk, uint64_t pos)
+{
+    uint16_t crcs[BATCH];
+    size_t m, k;
+    uint64_t q;
+
+    chunk->n_runs = 0;
+    while(pos < chunk->end && pos < log_len) {
+        if(log_len - pos < 16) {
+            /* A torn last write. */
+            add_run(chunk, pos, log_len - pos, false);
+            pos = log_len;
+            break;
+        }
+
+        /* Take good packets a batch at a time. */
+        m = (chunk->end - pos + 15) / 16;
+        if(m > (log_len - pos) / 16)
+            m = (log_len - pos) / 16;
+        if(m > BATCH)
+            m = BATCH;
+        m2crc_ccitt_batch(&log_buf[pos], 16, 14, m, 0x0000, 0x0000, crcs);
+        for(k=0; k<m && packet_ok(&log_buf[pos + 16*k], crcs[k]); k++);
+        if(k > 0) {
+            add_run(chunk, pos, 16*k, true);
+            pos += 16*k;
+        }
+        if(k == m)
+            continue;
+
+        /* Search on for the next good run, allowing a shorter one right at
+         * the end of the log.
+         */
+        for(q=pos+1; q+16<=log_len; q++) {
+            size_t n = (log_len - q) / 16;
+            if(run_ok(q, n < RESYNC ? n : RESYNC))
+                break;
+        }
+        if(q + 16 > log_len)
+            q = log_len;
+        add_run(chunk, pos, q - pos, false);
+        pos = q;
+    }
+    chunk->stop = pos;
+}
+
+static void* verify_chunk(void* arg)
+{
+    Chunk* chunk = arg;
+    verify_from(chunk, chunk->start);
+    return NULL;
+}
+
+/* Run verify_chunk on each of `n` chunks, each on its own thread if more
+ * than one.
+ */
+static void run_chunks(Chunk* chunks, int n)
+{
+    pthread_t tids[n];
+    int k;
+
+    if(n == 1) {
+        verify_chunk(&chunks[0]);
+        return;
+    }
+    for(k=0; k<n; k++) {
+        if(pthread_create(&tids[k], NULL, verify_chunk, &chunks[k]) != 0) {
+            printf("Error starting thread\n");
+            exit(1);
+        }
+    }
+    for(k=0; k<n; k++) {
+        pthread_join(tids[k], NULL);
+    }
+}
+
+/* Make `chunk` start exactly at `pos`, the previous chunk's stop. Runs
+ * before it are dropped, and a run `pos` falls in is cut short if verifying
+ * from `pos` would have found the same: a good run where `pos` starts a
+ * packet, or a bad run where `pos` does not start a good packet. Otherwise
+ * the chunk is verified again from `pos`.
+ */
+static void join_chunk(Chunk* chunk, uint64_t pos)
+{
+    size_t i;
+
+    for(i=0; i<chunk->n_runs; i++) {
+        Run* run = &chunk->runs[i];
+        if(run->offset + run->len <= pos)
+            continue;
+        if(run->offset == pos
+           || (run->good && (pos - run->offset) % 16 == 0)
+           || (!run->good && (log_len - pos < 16 || !run_ok(pos, 1)))) {
+            run->len -= pos - run->offset;
+            run->offset = pos;
+            memmove(chunk->runs, run, (chunk->n_runs - i) * sizeof(Run));
+            chunk->n_runs -= i;
+            return;
+        }
+        break;
+    }
+
+    if(pos >= chunk->end) {
+        chunk->n_runs = 0;
+        chunk->stop = pos;
+    } else {
+        verify_from(chunk, pos);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    int infd, outfd, opt, threads = 1, nround, k;
+    struct stat st;
+    const char* outname = NULL;
+    char outname_buf[1024];
+    Chunk* chunks;
+    uint64_t next = 0, pos = 0, align = 0, chunk_len;
+    size_t chunk_blocks = CHUNK_BLOCKS;
+    uint64_t good_bytes = 0, bad_bytes = 0, n_bad = 0, n_shifts = 0;
+    uint64_t last_block = UINT64_MAX, bad_blocks = 0;
+    size_t i;
+
+    while((opt = getopt(argc, argv, "j:c:o:")) != -1) {
+        switch(opt) {
+            case 'j': threads = atoi(optarg); break;
+            case 'c': chunk_blocks = strtoul(optarg, NULL, 0); break;
+            case 'o': outname = optarg; break;
+            default:
+                printf("Usage: %s [-j threads] [-c chunk blocks] "
+                       "[-o clean log] <logfile>\n", argv[0]);
+                return 1;
+        }
+    }
+    if(threads <= 0) {
+        threads = sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    if(optind != argc - 1 || chunk_blocks == 0) {
+        printf("Usage: %s [-j threads] [-c chunk blocks] [-o clean log] "
+               "<logfile>\n", argv[0]);
+        return 1;
+    }
+
+    infd = open(argv[optind], O_RDONLY);
+    if(infd < 0 || fstat(infd, &st) != 0) {
+        printf("Error opening log file\n");
+        return 1;
+    }
+    log_len = st.st_size;
+    if(log_len > 0) {
+        log_buf = mmap(NULL, log_len, PROT_READ, MAP_PRIVATE, infd, 0);
+        if(log_buf == MAP_FAILED) {
+            printf("Error mapping log file\n");
+            return 1;
+        }
+        madvise((void*)log_buf, log_len, MADV_SEQUENTIAL);
+    }
+
+    if(outname == NULL) {
+        if(snprintf(outname_buf, sizeof(outname_buf), "%s-clean.bin",
+                    basename(argv[optind])) >= (int)sizeof(outname_buf)) {
+            printf("Log file name too long\n");
+            return 1;
+        }
+        outname = outname_buf;
+    }
+    outfd = open(outname, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(outfd < 0) {
+        printf("Error opening clean log %s\n", outname);
+        return 1;
+    }
+
+    chunks = calloc(threads, sizeof(Chunk));
+    if(chunks == NULL) {
+        printf("Out of memory\n");
+        return 1;
+    }
+    chunk_len = (uint64_t)CACHE_BLOCK * chunk_blocks;
+
+    printf("Bad regions:\n");
+    printf("offset\t\tbytes\tblocks\t\tnotes\n");
+
+    while(next < log_len) {
+        /* Share out the next round of chunks. */
+        for(nround=0; nround<threads && next<log_len; nround++) {
+            chunks[nround].start = next;
+            next = next + chunk_len < log_len ? next + chunk_len : log_len;
+            chunks[nround].end = next;
+        }
+        run_chunks(chunks, nround);
+
+        for(k=0; k<nround; k++) {
+            if(chunks[k].start != pos)
+                join_chunk(&chunks[k], pos);
+
+            for(i=0; i<chunks[k].n_runs; i++) {
+                Run* run = &chunks[k].runs[i];
+                uint64_t end = run->offset + run->len;
+                uint64_t first_block, end_block;
+
+                if(run->good) {
+                    write_all(outfd, &log_buf[run->offset], run->len);
+                    good_bytes += run->len;
+                    align = end % 16;
+                    continue;
+                }
+
+                /* Every write but a torn last one is a whole cache block,
+                 * so blocks start at multiples of CACHE_BLOCK even after
+                 * packets have been misaligned.
+                 */
+                first_block = run->offset / CACHE_BLOCK;
+                end_block = (end + CACHE_BLOCK - 1) / CACHE_BLOCK;
+                bad_blocks += end_block - first_block
+                              - (first_block == last_block);
+                last_block = end_block - 1;
+
+                printf("0x%08llx\t%llu\t%llu", (unsigned long long)run->offset,
+                       (unsigned long long)run->len,
+                       (unsigned long long)first_block);
+                if(end_block - first_block > 1)
+                    printf("-%llu", (unsigned long long)end_block - 1);
+                printf("\t\t");
+                if(end == log_len && run->len < 16) {
+                    printf("torn end of log");
+                } else {
+                    bool zeros = true, ones = true;
+                    uint64_t b;
+                    for(b=run->offset; b<end && (zeros || ones); b++) {
+                        zeros = zeros && log_buf[b] == 0x00;
+                        ones = ones && log_buf[b] == 0xFF;
+                    }
+                    printf("%s", zeros ? "zeros" : ones ? "0xFF" : "corrupt");
+                    if(run->offset % CACHE_BLOCK == 0
+                       && end % CACHE_BLOCK == 0)
+                        printf(", whole blocks");
+                    else if(end % CACHE_BLOCK == 0)
+                        printf(", to end of block");
+                }
+                if(end < log_len && end % 16 != align) {
+                    printf(", realigned by +%d bytes",
+                           (int)((end - align) % 16));
+                    align = end % 16;
+                    n_shifts++;
+                }
+                printf("\n");
+
+                bad_bytes += run->len;
+                n_bad++;
+            }
+            pos = chunks[k].stop;
+        }
+    }
+
+    printf("\n%llu good packets, %llu bad regions totalling %llu bytes, "
+           "%llu realignments\n", (unsigned long long)good_bytes / 16,
+           (unsigned long long)n_bad, (unsigned long long)bad_bytes,
+           (unsigned long long)n_shifts);
+    printf("%llu of %llu cache blocks affected\n",
+           (unsigned long long)bad_blocks,
+           (unsigned long long)(log_len + CACHE_BLOCK - 1) / CACHE_BLOCK);
+
+    for(k=0; k<threads; k++)
+        free(chunks[k].runs);
+    free(chunks);
+    close(outfd);
+    if(log_len > 0)
+        munmap((void*)log_buf, log_len);
+    close(infd);
+
+    return 0;
+}
@@ -6,12 +6,19 @@ skip = 0
 if len(sys.argv) == 3:
     skip = int(sys.argv[2])
 
-data = np.loadtxt(sys.argv[1], delimiter=",", converters={2: lambda s: 0.0},
-                  skiprows=skip)
-ncols = data.shape[1] - 3
+if sys.argv[1].endswith(".npy"):
+    # From m2telem_dump -n, mapped rather than parsed.
+    data = np.load(sys.argv[1], mmap_mode="r")[skip:]
+    t = data['t'] / 168e6
+    values = data['value'].reshape(len(data), -1)
+else:
+    data = np.loadtxt(sys.argv[1], delimiter=",",
+                      converters={2: lambda s: 0.0}, skiprows=skip)
+    t = data[:, 0]
+    values = data[:, 3:]
 
-for i in range(ncols):
-    plt.plot(data[:, 0], data[:, i+3], '.-')
+for i in range(values.shape[1]):
+    plt.plot(t, values[:, i], '.-')
 
-plt.xlim(780, data[-1, 0])
+plt.xlim(780, t[-1])
 plt.show()